@@ -8,189 +8,2869 @@
 #include <spdlog/sinks/stdout_sinks.h>
 #include <spdlog/sinks/basic_file_sink.h>
 #include <spdlog/sinks/rotating_file_sink.h>
+#include <spdlog/sinks/base_sink.h>
 
-#include <map>
+#include <zstd.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <vector>
+#include <source_location>
 #include <string_view>
-#include <sstream>
+#include <atomic>
+#include <thread>
+#include <tuple>
+#include <new>
+#include <map>
+#include <mutex>
+#include <condition_variable>
+#include <cstdio>
+#include <csignal>
+#include <cstring>
+#include <exception>
+#include <ctime>
+#include <fstream>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <fmt/format.h>
+
+#include "sbpt_generated_includes.hpp"
+
+// Compile-time minimum level. Convenience wrappers for levels below this
+// compile to empty inline functions, so e.g. a hot-loop debug() in a release
+// build costs nothing — no fmt::format, no level check, no call. Uses the
+// SPDLOG_LEVEL_* numbering (0 = trace .. 6 = off); define it before including
+// this header (or on the command line) to strip levels per build.
+#ifndef LOGGER_COMPILE_TIME_LEVEL
+#define LOGGER_COMPILE_TIME_LEVEL SPDLOG_LEVEL_TRACE
+#endif
+
+// Section-bar prefixes ("| " per nesting level) precomputed up to this depth,
+// so a log call inside nested LogSections indexes a slice of a static string
+// instead of rebuilding the prefix with O(depth) appends per message.
+inline constexpr size_t max_precomputed_section_depth = 16;
+inline constexpr std::string_view section_prefix_bars = "| | | | | | | | | | | | | | | | ";
+
+inline constexpr std::string_view section_prefix_for_depth(int depth) {
+    size_t clamped = depth < 0 ? 0 : static_cast<size_t>(depth);
+    if (clamped > max_precomputed_section_depth) {
+        clamped = max_precomputed_section_depth;
+    }
+    return section_prefix_bars.substr(0, clamped * 2);
+}
+
+// Level names indexed directly by spdlog::level::level_enum (0 = trace .. 6 = off).
+inline constexpr std::array<std::string_view, 7> level_to_string = {"trace", "debug",    "info", "warning",
+                                                                    "error", "critical", "off"};
+
+inline constexpr size_t max_level_name_len = [] {
+    size_t max_len = 0;
+    for (std::string_view name : level_to_string) {
+        if (name.size() > max_len) {
+            max_len = name.size();
+        }
+    }
+    return max_len;
+}();
+
+// Per-level alignment padding, precomputed so the hot path does a single
+// indexed load instead of a map lookup plus a guarded static.
+inline constexpr std::string_view level_padding_blanks = "                ";
+inline constexpr std::array<std::string_view, 7> level_padding = [] {
+    std::array<std::string_view, 7> padding{};
+    for (size_t i = 0; i < level_to_string.size(); ++i) {
+        padding[i] = level_padding_blanks.substr(0, max_level_name_len - level_to_string[i].size());
+    }
+    return padding;
+}();
+
+/// 64-bit FNV-1a; shared by the section index (name hashes) and the intern
+/// table (content keys) so tooling only needs one hash implementation.
+constexpr uint64_t fnv1a_hash(std::string_view text) {
+    uint64_t hash = 14695981039346656037ull;
+    for (char c : text) {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+/**
+ * @brief Renders "[HH:MM:SS.ffffff] " timestamps without going through strftime per message.
+ *
+ * The "[HH:MM:SS." part only changes once a second, so it is rendered into a
+ * small cached buffer on rollover (one localtime_r per second) and memcpy'd
+ * per message; only the six microsecond digits are written fresh each time.
+ * Not thread-safe on its own — the Logger keeps one per thread.
+ */
+class TimestampCache {
+  public:
+    /// Appends "[HH:MM:SS.ffffff] " for the current wall-clock time.
+    void append_now(fmt::memory_buffer &buffer) {
+        const int64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                               std::chrono::system_clock::now().time_since_epoch())
+                               .count();
+        const int64_t seconds = ns / 1000000000;
+        if (seconds != cached_seconds_) {
+            std::time_t as_time_t = static_cast<std::time_t>(seconds);
+            std::tm local_tm{};
+            localtime_r(&as_time_t, &local_tm);
+            prefix_[0] = '[';
+            write_two_digits(prefix_ + 1, local_tm.tm_hour);
+            prefix_[3] = ':';
+            write_two_digits(prefix_ + 4, local_tm.tm_min);
+            prefix_[6] = ':';
+            write_two_digits(prefix_ + 7, local_tm.tm_sec);
+            prefix_[9] = '.';
+            cached_seconds_ = seconds;
+        }
+        buffer.append(std::string_view(prefix_, sizeof(prefix_)));
+
+        char sub_second[8];
+        int64_t micros = (ns % 1000000000) / 1000;
+        for (int i = 5; i >= 0; --i) {
+            sub_second[i] = static_cast<char>('0' + micros % 10);
+            micros /= 10;
+        }
+        sub_second[6] = ']';
+        sub_second[7] = ' ';
+        buffer.append(std::string_view(sub_second, sizeof(sub_second)));
+    }
+
+  private:
+    static void write_two_digits(char *out, int value) {
+        out[0] = static_cast<char>('0' + value / 10);
+        out[1] = static_cast<char>('0' + value % 10);
+    }
+
+    int64_t cached_seconds_ = -1; // never matches, so the first call renders
+    char prefix_[10] = {};        // "[HH:MM:SS."
+};
+
+/**
+ * @brief A compile-time-checked format string that also captures its call site.
+ *
+ * Drop-in replacement for fmt::format_string in signatures that need to know
+ * where they were called from (rate limiting, per-call-site stats): the
+ * std::source_location is captured implicitly at the call site, so callers
+ * just pass a format string as usual.
+ */
+template <typename... Args> struct basic_loc_format_string {
+    fmt::format_string<Args...> fmt;
+    std::source_location loc;
+
+    template <typename S>
+    consteval basic_loc_format_string(const S &s, std::source_location loc = std::source_location::current())
+        : fmt(s), loc(loc) {}
+};
+
+// type_identity_t keeps Args out of deduction, mirroring fmt::format_string
+template <typename... Args> using loc_format_string = basic_loc_format_string<std::type_identity_t<Args>...>;
+
+/**
+ * @class CallSiteRegistry
+ * @brief Fixed-size lock-free table of per-call-site counters.
+ *
+ * Call sites are keyed by source location (file pointer + line); lookups are
+ * open-addressed probes over atomic keys, so the hot path is a couple of
+ * relaxed loads. If the table ever fills, colliding call sites share a slot —
+ * counters merge, which degrades rate-limiting granularity but stays safe.
+ */
+class CallSiteRegistry {
+  public:
+    // One cache line per entry: different call sites never false-share, so
+    // cost accounting from many threads only contends when they hammer the
+    // *same* call site (where the counts belong together anyway).
+    struct alignas(64) Entry {
+        std::atomic<uint64_t> key{0};
+        std::atomic<uint64_t> hits{0};
+        std::atomic<uint64_t> suppressed{0};
+        std::atomic<int64_t> last_emit_ns{0};
+        std::atomic<const char *> location_label{nullptr}; ///< lazily built "file:line: " string
+        // cost-accounting counters (see Logger::dump_stats)
+        std::atomic<uint64_t> stat_count{0};
+        std::atomic<uint64_t> stat_bytes{0};
+        std::atomic<uint64_t> stat_ns{0};
+    };
+
+    /// Visits every claimed entry; used by the stats report.
+    template <typename Fn> void for_each(Fn &&fn) {
+        for (Entry &entry : entries_) {
+            if (entry.key.load(std::memory_order_acquire) != 0) {
+                fn(entry);
+            }
+        }
+    }
+
+    Entry &entry_for(const std::source_location &loc) {
+        // file_name() points at static storage, so the pointer value itself
+        // is a stable per-file key
+        uint64_t key = (reinterpret_cast<uintptr_t>(loc.file_name()) ^ (uint64_t(loc.line()) * 0x9E3779B97F4A7C15ull));
+        if (key == 0) {
+            key = 1; // 0 marks an empty slot
+        }
+        size_t idx = key & (table_size - 1);
+        for (size_t probe = 0; probe < max_probes; ++probe) {
+            Entry &entry = entries_[(idx + probe) & (table_size - 1)];
+            uint64_t existing = entry.key.load(std::memory_order_acquire);
+            if (existing == key) {
+                return entry;
+            }
+            if (existing == 0) {
+                if (entry.key.compare_exchange_strong(existing, key, std::memory_order_acq_rel)) {
+                    return entry;
+                }
+                if (existing == key) {
+                    return entry; // another thread claimed it for the same site
+                }
+            }
+        }
+        return entries_[idx]; // table saturated: share the home slot
+    }
+
+    /**
+     * @brief Returns the cached "file:line: " label for a call site.
+     *
+     * Built once per site on first use (basename only, formatted into a
+     * never-freed heap string) and published with a CAS, so every later
+     * location-annotated log call pays a single atomic load for its label
+     * instead of formatting the location per message.
+     */
+    static const char *location_label_for(Entry &entry, const std::source_location &loc) {
+        const char *label = entry.location_label.load(std::memory_order_acquire);
+        if (label != nullptr) {
+            return label;
+        }
+        std::string_view file(loc.file_name());
+        size_t slash = file.find_last_of('/');
+        if (slash != std::string_view::npos) {
+            file.remove_prefix(slash + 1);
+        }
+        std::string built = fmt::format("{}:{}: ", file, loc.line());
+        char *heap = new char[built.size() + 1];
+        std::memcpy(heap, built.c_str(), built.size() + 1);
+        const char *expected = nullptr;
+        if (entry.location_label.compare_exchange_strong(expected, heap, std::memory_order_acq_rel)) {
+            return heap;
+        }
+        delete[] heap; // another thread won the race
+        return expected;
+    }
+
+  private:
+    static constexpr size_t table_size = 512; // power of two
+    static constexpr size_t max_probes = 8;
+    std::array<Entry, table_size> entries_;
+};
+
+/**
+ * @class StringInternTable
+ * @brief Content-addressed intern table mapping repeated text to 4-byte IDs.
+ *
+ * A few hundred distinct message strings and section banners account for
+ * nearly all log volume, so the binary sink can write a 4-byte ID instead of
+ * the full text once a string has been seen. Fixed-size open-addressed
+ * table, same recipe as CallSiteRegistry: lock-free lookups (hash, a few
+ * probes, no locks anywhere), slots claimed with one CAS on first
+ * occurrence. Strings are interned by value (64-bit FNV-1a); a hash
+ * collision between distinct strings would conflate them, which at 1024
+ * live entries is vanishingly unlikely. When the table saturates, intern()
+ * returns 0 and callers fall back to writing full text.
+ */
+class StringInternTable {
+  public:
+    struct InternResult {
+        uint32_t id;           ///< 0 when the table is saturated
+        bool first_occurrence; ///< true exactly once per id, on the claiming call
+    };
+
+    InternResult intern(std::string_view text) {
+        uint64_t key = fnv1a_hash(text);
+        if (key == 0) {
+            key = 1; // 0 marks an empty slot
+        }
+        size_t index = static_cast<size_t>(key);
+        for (size_t probe = 0; probe < max_probes; ++probe, ++index) {
+            Entry &entry = table_[index & (table_size - 1)];
+            uint64_t existing = entry.key.load(std::memory_order_acquire);
+            if (existing == 0) {
+                uint64_t expected = 0;
+                if (entry.key.compare_exchange_strong(expected, key, std::memory_order_acq_rel)) {
+                    uint32_t id = next_id_.fetch_add(1, std::memory_order_relaxed);
+                    entry.id.store(id, std::memory_order_release);
+                    return {id, true};
+                }
+                existing = expected; // somebody else claimed it; fall through
+            }
+            if (existing == key) {
+                // the claimant publishes the id right after winning the CAS
+                uint32_t id;
+                while ((id = entry.id.load(std::memory_order_acquire)) == 0) {
+                }
+                return {id, false};
+            }
+        }
+        return {0, false};
+    }
+
+  private:
+    struct Entry {
+        std::atomic<uint64_t> key{0};
+        std::atomic<uint32_t> id{0}; // ids start at 1; 0 means "not yet published"
+    };
+
+    static constexpr size_t table_size = 1024; // power of two
+    static constexpr size_t max_probes = 8;
+
+    std::array<Entry, table_size> table_{};
+    std::atomic<uint32_t> next_id_{1};
+};
+
+/**
+ * @class BinaryMmapSink
+ * @brief Appends fixed-header binary log records into a memory-mapped file.
+ *
+ * The hot path is an atomic offset bump plus a memcpy into the mapping — no
+ * formatting, no syscalls. Records store the raw (unprefixed) message along
+ * with timestamp, level and section depth, so render_to_text() can reproduce
+ * the usual text output offline, and analysis tools can read the file as a
+ * zero-parse mmap.
+ *
+ * File layout: a FileHeader followed by packed Records, each a RecordHeader
+ * immediately followed by message_length bytes of message text. The header's
+ * used_bytes field tracks the end of valid data; the file is truncated to
+ * that size on close.
+ */
+class BinaryMmapSink {
+  public:
+    static constexpr uint32_t magic = 0x474C4253; // "SBLG" little-endian
+    static constexpr uint32_t version = 1;
+
+    struct FileHeader {
+        uint32_t magic;
+        uint32_t version;
+        uint64_t used_bytes;
+    };
+
+    /// Discriminates record payloads: plain message text, an encoded
+    /// structured event (see Logger::event()), an intern-table definition
+    /// (4-byte id + the text it stands for, written once per string), or an
+    /// interned message carrying just the 4-byte id.
+    enum RecordKind : uint16_t { kind_text = 0, kind_event = 1, kind_intern_def = 2, kind_interned = 3 };
+
+    struct RecordHeader {
+        uint64_t timestamp_ns; ///< system_clock nanoseconds since epoch
+        uint8_t level;
+        uint8_t section_depth;
+        uint16_t kind; ///< RecordKind
+        uint32_t message_length;
+    };
+
+    BinaryMmapSink(const std::string &file_path, size_t capacity_bytes) : capacity_(capacity_bytes) {
+        fd_ = ::open(file_path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (fd_ < 0) {
+            throw spdlog::spdlog_ex("BinaryMmapSink: failed to open " + file_path, errno);
+        }
+        if (::ftruncate(fd_, static_cast<off_t>(capacity_)) != 0) {
+            ::close(fd_);
+            throw spdlog::spdlog_ex("BinaryMmapSink: failed to size " + file_path, errno);
+        }
+        void *mapping = ::mmap(nullptr, capacity_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+        if (mapping == MAP_FAILED) {
+            ::close(fd_);
+            throw spdlog::spdlog_ex("BinaryMmapSink: failed to mmap " + file_path, errno);
+        }
+        base_ = static_cast<char *>(mapping);
+        FileHeader header{magic, version, sizeof(FileHeader)};
+        std::memcpy(base_, &header, sizeof(header));
+        offset_.store(sizeof(FileHeader), std::memory_order_relaxed);
+    }
+
+    ~BinaryMmapSink() {
+        size_t used = offset_.load(std::memory_order_relaxed);
+        used_bytes_ref().store(used, std::memory_order_relaxed);
+        ::munmap(base_, capacity_);
+        // shrink the file to the bytes actually written
+        if (::ftruncate(fd_, static_cast<off_t>(used)) != 0) {
+            // best effort; the header's used_bytes still bounds valid data
+        }
+        ::close(fd_);
+    }
+
+    BinaryMmapSink(const BinaryMmapSink &) = delete;
+    BinaryMmapSink &operator=(const BinaryMmapSink &) = delete;
+
+    /// Appends one record; silently stops writing once the mapping is full.
+    void write(spdlog::level::level_enum lvl, int section_depth, std::string_view msg,
+               RecordKind kind = kind_text) {
+        size_t record_size = sizeof(RecordHeader) + msg.size();
+        // Reserve [pos, pos + record_size) with a CAS loop. An add-then-
+        // rollback scheme is not safe here: with three writers racing at the
+        // capacity boundary, a rejected writer's fetch_sub can land between
+        // another writer's rejection and rollback and re-expose a range that
+        // a third writer then has accepted. A rejected CAS touches nothing.
+        size_t pos = offset_.load(std::memory_order_relaxed);
+        do {
+            if (pos + record_size > capacity_) {
+                return;
+            }
+        } while (!offset_.compare_exchange_weak(pos, pos + record_size, std::memory_order_relaxed));
+        RecordHeader header;
+        header.timestamp_ns = static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch())
+                .count());
+        header.level = static_cast<uint8_t>(lvl);
+        header.section_depth = static_cast<uint8_t>(section_depth < 0 ? 0 : section_depth);
+        header.kind = kind;
+        header.message_length = static_cast<uint32_t>(msg.size());
+        std::memcpy(base_ + pos, &header, sizeof(header));
+        std::memcpy(base_ + pos + sizeof(header), msg.data(), msg.size());
+        // Publish the new end of valid data for live readers: an atomic max
+        // (a plain store from concurrent writers is a data race and can tear
+        // the 8-byte value, and a slower writer finishing out of order must
+        // not move the watermark backward), release so the record bytes are
+        // visible before the header says they exist.
+        uint64_t used = pos + record_size;
+        uint64_t current = used_bytes_ref().load(std::memory_order_relaxed);
+        while (current < used &&
+               !used_bytes_ref().compare_exchange_weak(current, used, std::memory_order_release)) {
+        }
+    }
+
+    /// Writes the one-time definition record for an interned string.
+    void write_intern_def(uint32_t intern_id, std::string_view text) {
+        std::string payload;
+        payload.reserve(sizeof(intern_id) + text.size());
+        payload.append(reinterpret_cast<const char *>(&intern_id), sizeof(intern_id));
+        payload.append(text);
+        write(spdlog::level::trace, 0, payload, kind_intern_def);
+    }
+
+    /// Writes a 4-byte reference to a previously defined interned string.
+    void write_interned(spdlog::level::level_enum lvl, int section_depth, uint32_t intern_id) {
+        write(lvl, section_depth,
+              std::string_view(reinterpret_cast<const char *>(&intern_id), sizeof(intern_id)), kind_interned);
+    }
+
+    /**
+     * @brief Offline converter: renders a binary log file into the usual text format.
+     *
+     * Reproduces the "[HH:MM:SS.ffffff] [level]" prefix, level padding and
+     * section bars that the text sinks would have produced.
+     */
+    static bool render_to_text(const std::string &binary_path, std::ostream &out) {
+        std::ifstream in(binary_path, std::ios::binary);
+        if (!in) {
+            return false;
+        }
+        FileHeader file_header;
+        in.read(reinterpret_cast<char *>(&file_header), sizeof(file_header));
+        if (!in || file_header.magic != magic || file_header.version != version) {
+            return false;
+        }
+        uint64_t pos = sizeof(FileHeader);
+        std::string msg;
+        std::map<uint32_t, std::string> intern_dictionary;
+        // Pass 1: collect intern definitions. A reference can legitimately
+        // sit at a lower offset than its definition — under concurrency the
+        // id is published before the definition record reserves file space —
+        // so a single forward pass would render "<unknown intern id>" for
+        // strings whose definition appears later.
+        while (pos + sizeof(RecordHeader) <= file_header.used_bytes) {
+            RecordHeader header;
+            in.read(reinterpret_cast<char *>(&header), sizeof(header));
+            if (!in) {
+                return false;
+            }
+            if (header.kind == kind_intern_def) {
+                msg.resize(header.message_length);
+                in.read(msg.data(), header.message_length);
+                if (!in) {
+                    return false;
+                }
+                if (msg.size() >= sizeof(uint32_t)) {
+                    uint32_t intern_id;
+                    std::memcpy(&intern_id, msg.data(), sizeof(intern_id));
+                    intern_dictionary[intern_id] = msg.substr(sizeof(intern_id));
+                }
+            } else {
+                in.seekg(header.message_length, std::ios::cur);
+            }
+            pos += sizeof(RecordHeader) + header.message_length;
+        }
+        in.clear();
+        in.seekg(sizeof(FileHeader));
+        pos = sizeof(FileHeader);
+
+        // Pass 2: render, with every definition already in the dictionary.
+        while (pos + sizeof(RecordHeader) <= file_header.used_bytes) {
+            RecordHeader header;
+            in.read(reinterpret_cast<char *>(&header), sizeof(header));
+            if (!in) {
+                return false;
+            }
+            msg.resize(header.message_length);
+            in.read(msg.data(), header.message_length);
+            if (!in) {
+                return false;
+            }
+            pos += sizeof(RecordHeader) + header.message_length;
+
+            std::time_t secs = static_cast<std::time_t>(header.timestamp_ns / 1000000000ull);
+            uint64_t micros = (header.timestamp_ns % 1000000000ull) / 1000;
+            std::tm tm_buf;
+            localtime_r(&secs, &tm_buf);
+            std::string_view level_name = level_to_string[header.level];
+            std::string_view padding = level_padding[header.level];
+            std::string_view bars = section_prefix_for_depth(header.section_depth);
+
+            if (header.kind == kind_event) {
+                std::string decoded = decode_event(msg);
+                out << fmt::format("[{:02}:{:02}:{:02}.{:06}] [{}] {}{}{}\n", tm_buf.tm_hour, tm_buf.tm_min,
+                                   tm_buf.tm_sec, micros, level_name, padding, bars, decoded);
+                continue;
+            }
+
+            if (header.kind == kind_intern_def) {
+                continue; // dictionary entry, consumed in pass 1
+            }
+
+            if (header.kind == kind_interned) {
+                if (msg.size() != sizeof(uint32_t)) {
+                    continue;
+                }
+                uint32_t intern_id;
+                std::memcpy(&intern_id, msg.data(), sizeof(intern_id));
+                auto it = intern_dictionary.find(intern_id);
+                msg = it != intern_dictionary.end() ? it->second : fmt::format("<unknown intern id {}>", intern_id);
+            }
+
+            // mirror the per-line splitting of the text pipeline
+            std::string_view remaining(msg);
+            size_t start = 0;
+            while (start < remaining.size()) {
+                size_t end = remaining.find('\n', start);
+                std::string_view line = remaining.substr(
+                    start, end == std::string_view::npos ? std::string_view::npos : end - start);
+                out << fmt::format("[{:02}:{:02}:{:02}.{:06}] [{}] {}{}{}\n", tm_buf.tm_hour, tm_buf.tm_min,
+                                   tm_buf.tm_sec, micros, level_name, padding, bars, line);
+                if (end == std::string_view::npos) {
+                    break;
+                }
+                start = end + 1;
+            }
+        }
+        return true;
+    }
+
+    /// Renders an encoded event payload as "event NAME key=value ..." text.
+    static std::string decode_event(std::string_view payload) {
+        size_t pos = 0;
+        auto read_view = [&](size_t len) {
+            std::string_view v = payload.substr(pos, len);
+            pos += len;
+            return v;
+        };
+        auto read_u32 = [&] {
+            uint32_t v = 0;
+            if (pos + sizeof(v) <= payload.size()) {
+                std::memcpy(&v, payload.data() + pos, sizeof(v));
+            }
+            pos += sizeof(v);
+            return v;
+        };
+
+        std::string text = "event ";
+        text += read_view(read_u32());
+        uint32_t field_count = read_u32();
+        for (uint32_t i = 0; i < field_count && pos < payload.size(); ++i) {
+            std::string_view key = read_view(read_u32());
+            char tag = payload[pos++];
+            text += ' ';
+            text += key;
+            text += '=';
+            switch (tag) {
+            case 'i': {
+                int64_t v;
+                std::memcpy(&v, payload.data() + pos, sizeof(v));
+                pos += sizeof(v);
+                text += fmt::format("{}", v);
+                break;
+            }
+            case 'u': {
+                uint64_t v;
+                std::memcpy(&v, payload.data() + pos, sizeof(v));
+                pos += sizeof(v);
+                text += fmt::format("{}", v);
+                break;
+            }
+            case 'd': {
+                double v;
+                std::memcpy(&v, payload.data() + pos, sizeof(v));
+                pos += sizeof(v);
+                text += fmt::format("{}", v);
+                break;
+            }
+            case 'b': {
+                text += payload[pos++] != 0 ? "true" : "false";
+                break;
+            }
+            case 's': {
+                text += read_view(read_u32());
+                break;
+            }
+            default:
+                return text + "<corrupt>";
+            }
+        }
+        return text;
+    }
+
+  private:
+    /// Atomic view of the mapped header's used_bytes field. Safe to form:
+    /// the mapping is page-aligned and the field sits at an 8-byte offset.
+    std::atomic_ref<uint64_t> used_bytes_ref() {
+        return std::atomic_ref<uint64_t>(*reinterpret_cast<uint64_t *>(base_ + offsetof(FileHeader, used_bytes)));
+    }
+
+    int fd_ = -1;
+    char *base_ = nullptr;
+    size_t capacity_ = 0;
+    std::atomic<size_t> offset_{0};
+};
+
+/**
+ * @class CompressedFileSink
+ * @brief File sink that writes its output as streaming zstd frames.
+ *
+ * Log text compresses extremely well (typically ~10x), so for high-volume
+ * file logging this trades a little CPU on a dedicated thread for an order
+ * of magnitude less disk bandwidth. The logging thread only formats and
+ * appends to an in-memory batch; a background thread owns the ZSTD stream
+ * and the file. Frames are closed every ~frame_target_bytes of input, so
+ * the resulting .zst file is a sequence of independently decompressible
+ * frames (standard tools like `zstd -d` read it directly, and a reader can
+ * start from any frame boundary instead of the top of the file).
+ */
+class CompressedFileSink : public spdlog::sinks::base_sink<std::mutex> {
+  public:
+    explicit CompressedFileSink(const std::string &file_path, int compression_level = 3,
+                                size_t frame_target_bytes = 1 << 20)
+        : frame_target_bytes_(frame_target_bytes) {
+        file_ = std::fopen(file_path.c_str(), "wb");
+        if (file_ == nullptr) {
+            throw spdlog::spdlog_ex("CompressedFileSink: failed to open " + file_path, errno);
+        }
+        stream_ = ZSTD_createCStream();
+        if (stream_ == nullptr) {
+            std::fclose(file_);
+            throw spdlog::spdlog_ex("CompressedFileSink: ZSTD_createCStream failed");
+        }
+        ZSTD_CCtx_setParameter(stream_, ZSTD_c_compressionLevel, compression_level);
+        out_buffer_.resize(ZSTD_CStreamOutSize());
+        worker_ = std::thread([this] { run(); });
+    }
+
+    ~CompressedFileSink() override {
+        {
+            std::lock_guard<std::mutex> lock(base_sink<std::mutex>::mutex_);
+            stopping_ = true;
+        }
+        batch_ready_.notify_one();
+        worker_.join();
+        ZSTD_freeCStream(stream_);
+        std::fclose(file_);
+    }
+
+  protected:
+    /// Hot path (called under the base_sink mutex): format and hand the bytes
+    /// to the compression thread. No zstd work, no file I/O.
+    void sink_it_(const spdlog::details::log_msg &msg) override {
+        spdlog::memory_buf_t formatted;
+        base_sink<std::mutex>::formatter_->format(msg, formatted);
+        pending_.append(formatted.data(), formatted.size());
+        batch_ready_.notify_one();
+    }
+
+    void flush_() override {
+        flush_requested_ = true;
+        batch_ready_.notify_one();
+    }
+
+  private:
+    /// Compression-thread loop: swap out the pending batch under the sink
+    /// mutex, then compress and write with the mutex released.
+    void run() {
+        std::string batch;
+        std::unique_lock<std::mutex> lock(base_sink<std::mutex>::mutex_);
+        for (;;) {
+            batch_ready_.wait(lock, [this] { return !pending_.empty() || flush_requested_ || stopping_; });
+            std::swap(batch, pending_);
+            const bool do_flush = flush_requested_;
+            const bool do_stop = stopping_;
+            flush_requested_ = false;
+            lock.unlock();
+
+            if (!batch.empty()) {
+                compress_chunk(batch);
+                batch.clear();
+            }
+            if (do_stop) {
+                end_frame();
+                std::fflush(file_);
+                return;
+            }
+            if (do_flush) {
+                // push buffered compressed data out without closing the frame
+                drive_stream(ZSTD_e_flush);
+                std::fflush(file_);
+            }
+            lock.lock();
+        }
+    }
+
+    void compress_chunk(std::string_view data) {
+        ZSTD_inBuffer input{data.data(), data.size(), 0};
+        while (input.pos < input.size) {
+            ZSTD_outBuffer output{out_buffer_.data(), out_buffer_.size(), 0};
+            size_t rc = ZSTD_compressStream2(stream_, &output, &input, ZSTD_e_continue);
+            if (ZSTD_isError(rc)) {
+                return; // encoder is wedged; drop the batch rather than spin
+            }
+            std::fwrite(out_buffer_.data(), 1, output.pos, file_);
+        }
+        frame_bytes_ += data.size();
+        if (frame_bytes_ >= frame_target_bytes_) {
+            end_frame();
+        }
+    }
+
+    void end_frame() {
+        drive_stream(ZSTD_e_end);
+        frame_bytes_ = 0;
+    }
+
+    /// Runs the encoder with no new input until @p directive completes.
+    void drive_stream(ZSTD_EndDirective directive) {
+        ZSTD_inBuffer input{nullptr, 0, 0};
+        size_t remaining;
+        do {
+            ZSTD_outBuffer output{out_buffer_.data(), out_buffer_.size(), 0};
+            remaining = ZSTD_compressStream2(stream_, &output, &input, directive);
+            if (ZSTD_isError(remaining)) {
+                return;
+            }
+            std::fwrite(out_buffer_.data(), 1, output.pos, file_);
+        } while (remaining != 0);
+    }
+
+    std::FILE *file_ = nullptr;
+    ZSTD_CStream *stream_ = nullptr;
+    size_t frame_target_bytes_;
+
+    // shared with the compression thread, guarded by the base_sink mutex
+    std::string pending_;
+    bool flush_requested_ = false;
+    bool stopping_ = false;
+    std::condition_variable batch_ready_;
+
+    // compression-thread only
+    std::vector<char> out_buffer_;
+    size_t frame_bytes_ = 0;
+    std::thread worker_;
+};
+
+/**
+ * @class ShmLogSink
+ * @brief Publishes formatted records into a per-process shared-memory ring.
+ *
+ * For hosts running many worker processes, per-process file sinks thrash the
+ * disk and leave analysis spread across files. This sink writes each record
+ * (wall-clock timestamp + formatted text) into an SPSC byte ring in a POSIX
+ * shared-memory segment named "/<region>.<pid>.<n>"; the logger_shm_collector
+ * build target opens every segment of a region, merges records by timestamp
+ * and writes one output stream. The producer never blocks on the collector:
+ * when the ring is full the record is dropped and a shared drop counter is
+ * bumped. The base_sink mutex serializes threads within the process, so each
+ * segment has exactly one producer; the collector is the one consumer.
+ */
+class ShmLogSink : public spdlog::sinks::base_sink<std::mutex> {
+  public:
+    static constexpr uint32_t shm_magic = 0x48534253; // "SBSH" little-endian
+
+    struct SegmentHeader {
+        uint32_t magic;
+        uint32_t version;
+        uint64_t capacity; // ring bytes, power of two
+        uint32_t pid;      // producer process, so the collector can reap dead segments
+        uint32_t reserved;
+        // producer and collector bump different counters; separate cache
+        // lines avoid false sharing across the process boundary too
+        alignas(64) std::atomic<uint64_t> head;    // next byte the producer writes
+        alignas(64) std::atomic<uint64_t> tail;    // next byte the collector reads
+        alignas(64) std::atomic<uint64_t> dropped; // records lost to a full ring
+    };
+
+    struct RecordHeader {
+        int64_t timestamp_ns; // system clock, the collector's merge key
+        uint32_t length;      // payload bytes following this header
+        uint32_t level;
+    };
+
+    explicit ShmLogSink(const std::string &region_name, size_t capacity_bytes = 1 << 20) {
+        size_t capacity = 1;
+        while (capacity < capacity_bytes) {
+            capacity <<= 1;
+        }
+        // one segment per sink instance: pid plus a counter keeps names unique
+        static std::atomic<int> next_segment{0};
+        name_ = fmt::format("/{}.{}.{}", region_name, ::getpid(), next_segment.fetch_add(1, std::memory_order_relaxed));
+        int fd = ::shm_open(name_.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+        if (fd < 0) {
+            throw spdlog::spdlog_ex("ShmLogSink: shm_open failed for " + name_, errno);
+        }
+        map_size_ = sizeof(SegmentHeader) + capacity;
+        if (::ftruncate(fd, static_cast<off_t>(map_size_)) != 0) {
+            ::close(fd);
+            ::shm_unlink(name_.c_str());
+            throw spdlog::spdlog_ex("ShmLogSink: ftruncate failed for " + name_, errno);
+        }
+        void *mapped = ::mmap(nullptr, map_size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        ::close(fd); // the mapping keeps the segment alive
+        if (mapped == MAP_FAILED) {
+            ::shm_unlink(name_.c_str());
+            throw spdlog::spdlog_ex("ShmLogSink: mmap failed for " + name_, errno);
+        }
+        base_ = static_cast<char *>(mapped);
+        header_ = new (base_) SegmentHeader{};
+        header_->capacity = capacity;
+        header_->pid = static_cast<uint32_t>(::getpid());
+        header_->version = 1;
+        ring_ = base_ + sizeof(SegmentHeader);
+        // publish the magic last so a collector never sees a half-built header
+        std::atomic_thread_fence(std::memory_order_release);
+        header_->magic = shm_magic;
+    }
+
+    /// The segment is left in place for the collector, which unlinks drained
+    /// segments once their producer process is gone.
+    ~ShmLogSink() override { ::munmap(base_, map_size_); }
+
+    const std::string &segment_name() const { return name_; }
+    uint64_t dropped_count() const { return header_->dropped.load(std::memory_order_relaxed); }
+
+    /**
+     * @class Reader
+     * @brief Collector-side view of one segment: peek/pop records in order.
+     */
+    class Reader {
+      public:
+        explicit Reader(const std::string &shm_name) : name_(shm_name) {
+            int fd = ::shm_open(shm_name.c_str(), O_RDWR, 0);
+            if (fd < 0) {
+                throw spdlog::spdlog_ex("ShmLogSink::Reader: shm_open failed for " + shm_name, errno);
+            }
+            struct stat file_info{};
+            if (::fstat(fd, &file_info) != 0 || static_cast<size_t>(file_info.st_size) < sizeof(SegmentHeader)) {
+                ::close(fd);
+                throw spdlog::spdlog_ex("ShmLogSink::Reader: bad segment " + shm_name);
+            }
+            map_size_ = static_cast<size_t>(file_info.st_size);
+            void *mapped = ::mmap(nullptr, map_size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            ::close(fd);
+            if (mapped == MAP_FAILED) {
+                throw spdlog::spdlog_ex("ShmLogSink::Reader: mmap failed for " + shm_name, errno);
+            }
+            base_ = static_cast<char *>(mapped);
+            header_ = reinterpret_cast<SegmentHeader *>(base_);
+            ring_ = base_ + sizeof(SegmentHeader);
+            if (header_->magic != shm_magic) {
+                ::munmap(base_, map_size_);
+                throw spdlog::spdlog_ex("ShmLogSink::Reader: bad magic in " + shm_name);
+            }
+        }
+
+        ~Reader() { ::munmap(base_, map_size_); }
+        Reader(const Reader &) = delete;
+        Reader &operator=(const Reader &) = delete;
+
+        /// Reads the next record header without consuming it.
+        bool peek(RecordHeader &record) const {
+            uint64_t tail = header_->tail.load(std::memory_order_relaxed);
+            if (header_->head.load(std::memory_order_acquire) - tail < sizeof(RecordHeader)) {
+                return false;
+            }
+            ring_read(tail, &record, sizeof(record));
+            return true;
+        }
+
+        /// Consumes the next record, appending its payload to @p payload.
+        void pop(const RecordHeader &record, std::string &payload) {
+            uint64_t tail = header_->tail.load(std::memory_order_relaxed);
+            size_t previous_size = payload.size();
+            payload.resize(previous_size + record.length);
+            ring_read(tail + sizeof(RecordHeader), payload.data() + previous_size, record.length);
+            header_->tail.store(tail + sizeof(RecordHeader) + record.length, std::memory_order_release);
+        }
+
+        /// False once the producer process has exited (segment can be reaped).
+        bool producer_alive() const {
+            return ::kill(static_cast<pid_t>(header_->pid), 0) == 0 || errno != ESRCH;
+        }
+
+        uint32_t producer_pid() const { return header_->pid; }
+        uint64_t dropped_count() const { return header_->dropped.load(std::memory_order_relaxed); }
+        const std::string &name() const { return name_; }
+
+        /// Removes the segment from /dev/shm (call after draining a dead producer's ring).
+        void unlink() const { ::shm_unlink(name_.c_str()); }
+
+      private:
+        void ring_read(uint64_t pos, void *out, size_t size) const {
+            const uint64_t mask = header_->capacity - 1;
+            size_t offset = static_cast<size_t>(pos & mask);
+            size_t first = std::min(size, static_cast<size_t>(header_->capacity) - offset);
+            std::memcpy(out, ring_ + offset, first);
+            std::memcpy(static_cast<char *>(out) + first, ring_, size - first);
+        }
+
+        std::string name_;
+        char *base_ = nullptr;
+        SegmentHeader *header_ = nullptr;
+        char *ring_ = nullptr;
+        size_t map_size_ = 0;
+    };
+
+  protected:
+    /// Producer path: format, then two wrapping memcpys into the ring. A full
+    /// ring drops the record — producers never wait for the collector.
+    void sink_it_(const spdlog::details::log_msg &msg) override {
+        spdlog::memory_buf_t formatted;
+        base_sink<std::mutex>::formatter_->format(msg, formatted);
+        RecordHeader record{
+            std::chrono::duration_cast<std::chrono::nanoseconds>(msg.time.time_since_epoch()).count(),
+            static_cast<uint32_t>(formatted.size()), static_cast<uint32_t>(msg.level)};
+        const uint64_t total = sizeof(record) + formatted.size();
+        const uint64_t head = header_->head.load(std::memory_order_relaxed);
+        const uint64_t tail = header_->tail.load(std::memory_order_acquire);
+        if (header_->capacity - (head - tail) < total) {
+            header_->dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        ring_write(head, &record, sizeof(record));
+        ring_write(head + sizeof(record), formatted.data(), formatted.size());
+        header_->head.store(head + total, std::memory_order_release);
+    }
+
+    void flush_() override {} // nothing buffered on the producer side
+
+  private:
+    void ring_write(uint64_t pos, const void *data, size_t size) {
+        const uint64_t mask = header_->capacity - 1;
+        size_t offset = static_cast<size_t>(pos & mask);
+        size_t first = std::min(size, static_cast<size_t>(header_->capacity) - offset);
+        std::memcpy(ring_ + offset, data, first);
+        std::memcpy(ring_, static_cast<const char *>(data) + first, size - first);
+    }
+
+    std::string name_;
+    char *base_ = nullptr;
+    SegmentHeader *header_ = nullptr;
+    char *ring_ = nullptr;
+    size_t map_size_ = 0;
+};
+
+/**
+ * @class SectionIndexWriter
+ * @brief Sidecar index of section boundaries for O(1) seeks into huge logs.
+ *
+ * Analysis tools reconstruct the section tree by scanning the whole log for
+ * "start {" / "end }" banners, which takes minutes on multi-GB files. With
+ * the index enabled (Logger::enable_section_index()), every section start
+ * and end appends one fixed-size record — byte offset of the banner line in
+ * the main log, depth, FNV-1a hash of the section name, wall-clock
+ * timestamp — to an in-memory batch that is written out only when it fills
+ * (or on flush/destruction), so the hot path is a vector push_back. Readers
+ * hash the name they're looking for, binary- or linear-scan the tiny index,
+ * and seek the main log directly.
+ */
+class SectionIndexWriter {
+  public:
+    static constexpr uint32_t index_magic = 0x58494253; // "SBIX" little-endian
+
+    enum RecordKind : uint8_t { kind_start = 0, kind_end = 1 };
+
+    struct FileHeader {
+        uint32_t magic;
+        uint32_t version;
+    };
+
+    struct IndexRecord {
+        uint64_t byte_offset; // offset of the banner line in the main log
+        int64_t timestamp_ns; // system clock
+        uint64_t name_hash;   // fnv1a of the section name
+        uint16_t depth;       // depth of the section being opened/closed
+        uint8_t kind;         // RecordKind
+        uint8_t reserved[5];
+    };
+
+    explicit SectionIndexWriter(const std::string &file_path, size_t batch_records = 256)
+        : batch_records_(batch_records) {
+        file_ = std::fopen(file_path.c_str(), "wb");
+        if (file_ == nullptr) {
+            throw spdlog::spdlog_ex("SectionIndexWriter: failed to open " + file_path, errno);
+        }
+        FileHeader header{index_magic, 1};
+        std::fwrite(&header, sizeof(header), 1, file_);
+        batch_.reserve(batch_records_);
+    }
+
+    ~SectionIndexWriter() {
+        flush();
+        std::fclose(file_);
+    }
+
+    SectionIndexWriter(const SectionIndexWriter &) = delete;
+    SectionIndexWriter &operator=(const SectionIndexWriter &) = delete;
+
+    /// Hot path: one push_back into the batch; file I/O only when it fills.
+    void append(uint64_t byte_offset, int depth, std::string_view name, RecordKind kind) {
+        IndexRecord record{};
+        record.byte_offset = byte_offset;
+        record.timestamp_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                  std::chrono::system_clock::now().time_since_epoch())
+                                  .count();
+        record.name_hash = hash_name(name);
+        record.depth = static_cast<uint16_t>(depth);
+        record.kind = kind;
+        std::lock_guard<std::mutex> lock(mutex_);
+        batch_.push_back(record);
+        if (batch_.size() >= batch_records_) {
+            write_batch();
+        }
+    }
+
+    /// Writes out any batched records.
+    void flush() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        write_batch();
+        std::fflush(file_);
+    }
+
+    /// The hash tools should use to look up a section by name.
+    static constexpr uint64_t hash_name(std::string_view name) { return fnv1a_hash(name); }
+
+    /// Debug helper: dumps an index file as text, one record per line.
+    static void render_to_text(const std::string &file_path, std::ostream &out) {
+        std::ifstream in(file_path, std::ios::binary);
+        FileHeader header{};
+        in.read(reinterpret_cast<char *>(&header), sizeof(header));
+        if (!in || header.magic != index_magic) {
+            out << "not a section index file\n";
+            return;
+        }
+        IndexRecord record{};
+        while (in.read(reinterpret_cast<char *>(&record), sizeof(record))) {
+            out << fmt::format("{} offset={} depth={} name_hash={:016x} t={}\n",
+                               record.kind == kind_start ? "start" : "end  ", record.byte_offset, record.depth,
+                               record.name_hash, record.timestamp_ns);
+        }
+    }
+
+  private:
+    // mutex_ held
+    void write_batch() {
+        if (!batch_.empty()) {
+            std::fwrite(batch_.data(), sizeof(IndexRecord), batch_.size(), file_);
+            batch_.clear();
+        }
+    }
+
+    std::FILE *file_ = nullptr;
+    size_t batch_records_;
+    std::mutex mutex_;
+    std::vector<IndexRecord> batch_;
+};
+
+/**
+ * @brief One field of a structured log event; create with kv().
+ *
+ * The key is expected to be a string literal (it is referenced, not copied,
+ * until the event is encoded on the calling thread).
+ */
+template <typename T> struct KeyValue {
+    std::string_view key;
+    T value;
+};
+
+/// Builder for structured event fields: kv("frame", n), kv("ms", dt), ...
+template <typename T> constexpr KeyValue<std::decay_t<T>> kv(std::string_view key, T &&value) {
+    return {key, std::forward<T>(value)};
+}
+
+/**
+ * @class EmergencyRing
+ * @brief Pre-allocated flight recorder holding the last N formatted records.
+ *
+ * Steady-state writes are a truncating memcpy into a fixed slot — never an
+ * allocation — so the ring can stay on in production. dump() uses only
+ * async-signal-safe write() calls, which is what lets the crash handler
+ * empty it from inside a signal handler after buffered file sinks have
+ * already lost their tail.
+ */
+class EmergencyRing {
+  public:
+    static constexpr size_t max_record_text = 252;
+
+    struct Record {
+        uint32_t length = 0;
+        char text[max_record_text];
+    };
+
+    explicit EmergencyRing(size_t capacity) : records_(capacity) {}
+
+    /// Copies "[level] message" into the next slot, truncating to fit.
+    void write(spdlog::level::level_enum lvl, std::string_view msg) {
+        Record &record = records_[next_.fetch_add(1, std::memory_order_relaxed) % records_.size()];
+        std::string_view level_name = level_to_string[static_cast<size_t>(lvl)];
+        size_t pos = 0;
+        record.text[pos++] = '[';
+        std::memcpy(record.text + pos, level_name.data(), level_name.size());
+        pos += level_name.size();
+        record.text[pos++] = ']';
+        record.text[pos++] = ' ';
+        size_t copy_len = std::min(msg.size(), max_record_text - pos);
+        std::memcpy(record.text + pos, msg.data(), copy_len);
+        record.length = static_cast<uint32_t>(pos + copy_len);
+    }
+
+    /// Writes the ring contents (oldest first) to @p fd. Async-signal-safe:
+    /// touches no locks, allocates nothing, calls only write().
+    void dump(int fd) const {
+        uint64_t total = next_.load(std::memory_order_relaxed);
+        uint64_t begin = total > records_.size() ? total - records_.size() : 0;
+        for (uint64_t i = begin; i < total; ++i) {
+            const Record &record = records_[i % records_.size()];
+            size_t len = std::min<size_t>(record.length, max_record_text);
+            (void)!::write(fd, record.text, len);
+            (void)!::write(fd, "\n", 1);
+        }
+    }
+
+  private:
+    std::vector<Record> records_; ///< allocated once at construction
+    std::atomic<uint64_t> next_{0};
+};
+
+/**
+ * @class DeferredLogRecord
+ * @brief Type-erased capture of a format string plus decayed argument copies.
+ *
+ * Used by the deferred-formatting path: the calling thread stores the format
+ * string and by-value copies of the arguments here, and the actual
+ * fmt::format runs later on the async worker thread. Payloads up to
+ * inline_capacity bytes (comfortably three scalar arguments plus the format
+ * string view) live in an inline buffer, so capturing them never allocates.
+ *
+ * Arguments are copied with std::decay, so string literals and std::string
+ * values are safe; raw pointers into transient buffers are not — stringify
+ * those before logging.
+ */
+class DeferredLogRecord {
+  public:
+    static constexpr size_t inline_capacity = 128;
+
+    DeferredLogRecord() = default;
+
+    DeferredLogRecord(DeferredLogRecord &&other) noexcept { move_from(other); }
+
+    DeferredLogRecord &operator=(DeferredLogRecord &&other) noexcept {
+        if (this != &other) {
+            reset();
+            move_from(other);
+        }
+        return *this;
+    }
+
+    DeferredLogRecord(const DeferredLogRecord &) = delete;
+    DeferredLogRecord &operator=(const DeferredLogRecord &) = delete;
+
+    ~DeferredLogRecord() { reset(); }
+
+    /// Captures the format string and decayed copies of the arguments.
+    template <typename... Args> void capture(fmt::string_view fmt_str, Args &&...args) {
+        struct Payload {
+            fmt::string_view fmt;
+            std::tuple<std::decay_t<Args>...> values;
+        };
+
+        static constexpr auto format_fn = [](void *p, fmt::memory_buffer &out) {
+            auto *payload = static_cast<Payload *>(p);
+            std::apply(
+                [&](const auto &...values) {
+                    fmt::format_to(std::back_inserter(out), fmt::runtime(payload->fmt), values...);
+                },
+                payload->values);
+        };
+
+        reset();
+        if constexpr (sizeof(Payload) <= inline_capacity) {
+            static const Ops inline_ops = {
+                format_fn,
+                [](void *p) { static_cast<Payload *>(p)->~Payload(); },
+                [](void *dst, void *src) {
+                    new (dst) Payload(std::move(*static_cast<Payload *>(src)));
+                    static_cast<Payload *>(src)->~Payload();
+                },
+            };
+            new (storage_) Payload{fmt_str, std::tuple<std::decay_t<Args>...>(std::forward<Args>(args)...)};
+            on_heap_ = false;
+            ops_ = &inline_ops;
+        } else {
+            static const Ops heap_ops = {
+                format_fn,
+                [](void *p) { delete static_cast<Payload *>(p); },
+                nullptr, // heap payloads move by pointer, no relocation needed
+            };
+            heap_ptr() = new Payload{fmt_str, std::tuple<std::decay_t<Args>...>(std::forward<Args>(args)...)};
+            on_heap_ = true;
+            ops_ = &heap_ops;
+        }
+    }
+
+    bool valid() const { return ops_ != nullptr; }
+
+    /// Runs the captured fmt::format into @p out (consumer-thread side).
+    void format(fmt::memory_buffer &out) { ops_->format(payload(), out); }
+
+    void reset() {
+        if (ops_ != nullptr) {
+            ops_->destroy(payload());
+            ops_ = nullptr;
+        }
+    }
+
+  private:
+    struct Ops {
+        void (*format)(void *payload, fmt::memory_buffer &out);
+        void (*destroy)(void *payload);
+        void (*relocate)(void *dst, void *src);
+    };
+
+    void *payload() { return on_heap_ ? heap_ptr() : static_cast<void *>(storage_); }
+
+    void *&heap_ptr() { return *reinterpret_cast<void **>(storage_); }
+
+    void move_from(DeferredLogRecord &other) noexcept {
+        ops_ = other.ops_;
+        on_heap_ = other.on_heap_;
+        if (ops_ == nullptr) {
+            return;
+        }
+        if (on_heap_) {
+            heap_ptr() = other.heap_ptr();
+        } else {
+            ops_->relocate(storage_, other.storage_);
+        }
+        other.ops_ = nullptr;
+    }
+
+    alignas(std::max_align_t) char storage_[inline_capacity];
+    const Ops *ops_ = nullptr;
+    bool on_heap_ = false;
+};
+
+/**
+ * @class LogRecordRingBuffer
+ * @brief Bounded lock-free ring buffer holding pre-formatted log records.
+ *
+ * Multiple producer threads may push concurrently; records are drained by the
+ * async worker thread. Both push and pop are wait-free in the common case
+ * (one CAS on a per-slot sequence counter), so the producer side stays in the
+ * low hundreds of nanoseconds even with a file sink attached downstream.
+ */
+class LogRecordRingBuffer {
+  public:
+    struct Record {
+        spdlog::level::level_enum lvl;
+        std::string text;           ///< pre-formatted path: the finished line
+        DeferredLogRecord deferred; ///< deferred path: format runs on the worker
+        int section_depth = 0;      ///< depth at capture time, for deferred prefixing
+    };
+
+    explicit LogRecordRingBuffer(size_t capacity) {
+        // round up to a power of two so wrapping is a mask, not a modulo
+        size_t pow2 = 1;
+        while (pow2 < capacity) {
+            pow2 <<= 1;
+        }
+        capacity_ = pow2;
+        mask_ = pow2 - 1;
+        slots_ = std::make_unique<Slot[]>(capacity_);
+        for (size_t i = 0; i < capacity_; ++i) {
+            slots_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    /// Attempts to enqueue a record; returns false when the buffer is full.
+    bool try_push(Record &&record) {
+        size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+        while (true) {
+            Slot &slot = slots_[pos & mask_];
+            size_t seq = slot.sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+            if (diff == 0) {
+                if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    slot.record = std::move(record);
+                    slot.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false; // full
+            } else {
+                pos = enqueue_pos_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    /// Attempts to dequeue a record; returns false when the buffer is empty.
+    bool try_pop(Record &out) {
+        size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+        while (true) {
+            Slot &slot = slots_[pos & mask_];
+            size_t seq = slot.sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+            if (diff == 0) {
+                if (dequeue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    out = std::move(slot.record);
+                    slot.sequence.store(pos + capacity_, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false; // empty
+            } else {
+                pos = dequeue_pos_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    /// Drops the oldest record to make room; used by OverflowPolicy::drop_oldest.
+    bool discard_oldest() {
+        Record discarded;
+        return try_pop(discarded);
+    }
+
+  private:
+    struct Slot {
+        std::atomic<size_t> sequence;
+        Record record;
+    };
+
+    std::unique_ptr<Slot[]> slots_;
+    size_t capacity_;
+    size_t mask_;
+    // producers and the consumer bump different counters; keep them on
+    // separate cache lines so they don't false-share
+    alignas(64) std::atomic<size_t> enqueue_pos_{0};
+    alignas(64) std::atomic<size_t> dequeue_pos_{0};
+};
+
+// NOTE: this is replacing everything else.
+class Logger {
+  public:
+    /**
+     * @brief A near-trivial shell: stores the name, creates nothing.
+     *
+     * The spdlog logger, default stdout sink and registry entry are only
+     * created on the first emission (or the first sink/config call that
+     * needs them), so tools that construct dozens of subsystem loggers up
+     * front pay a string copy per logger instead of sink allocation plus a
+     * pass through the registry lock — and loggers that never log cost
+     * nothing at all.
+     */
+    explicit Logger(std::string_view base_name = "section_logger")
+        : section_depth_(0), current_level_(spdlog::level::debug), current_pattern_("[%H:%M:%S.%f] [%^%l%$] %v"),
+          base_name_(base_name) {}
+
+    ~Logger() { disable_async(); }
+
+    /// Deleted copies: the async worker thread owns a reference to this instance.
+    Logger(const Logger &) = delete;
+    Logger &operator=(const Logger &) = delete;
+
+    /// What to do when the async ring buffer is full.
+    enum class OverflowPolicy {
+        block,       ///< spin until the worker frees a slot (never loses messages)
+        drop_oldest, ///< discard the oldest queued record to make room
+        drop_newest  ///< discard the record being logged
+    };
+
+    // ====== Async mode ======
+    /**
+     * @brief Switches delivery to a background thread fed by a lock-free ring buffer.
+     *
+     * Messages are still formatted on the calling thread, but the sink I/O
+     * (which dominates the cost with file sinks attached) happens on a
+     * dedicated worker, so the producer side is just a ring-buffer push.
+     *
+     * @param queue_size Capacity of the ring buffer (rounded up to a power of two).
+     * @param policy What to do when producers outrun the worker.
+     */
+    void enable_async(size_t queue_size = 8192, OverflowPolicy policy = OverflowPolicy::block) {
+        if (async_running_.load(std::memory_order_acquire)) {
+            return;
+        }
+        overflow_policy_.store(policy, std::memory_order_relaxed);
+        std::atomic_store_explicit(&async_queue_, std::make_shared<LogRecordRingBuffer>(queue_size),
+                                   std::memory_order_release);
+        async_running_.store(true, std::memory_order_release);
+        async_worker_ = std::thread([this] { drain_async_queue(); });
+    }
+
+    /// Drains any queued records, stops the worker thread and returns to
+    /// synchronous delivery. Safe against concurrent loggers: producers hold
+    /// the ring through a shared_ptr snapshot (same RCU idea as the sinks),
+    /// so one caught mid-push keeps it alive past the reset here. A record
+    /// such a producer lands *after* the worker's final drain is dropped.
+    void disable_async() {
+        if (!async_running_.load(std::memory_order_acquire)) {
+            return;
+        }
+        async_running_.store(false, std::memory_order_release);
+        if (async_worker_.joinable()) {
+            async_worker_.join();
+        }
+        std::atomic_store_explicit(&async_queue_, std::shared_ptr<LogRecordRingBuffer>{},
+                                   std::memory_order_release);
+    }
+
+    bool async_enabled() const { return async_running_.load(std::memory_order_acquire); }
+
+    /**
+     * @brief Opt-in: capture fmt arguments by value and format on the worker thread.
+     *
+     * With this on (and async mode enabled), the variadic log()/trace()/...
+     * overloads skip fmt::format on the caller entirely and enqueue a
+     * DeferredLogRecord instead; the worker formats, prefixes and emits.
+     * Arguments are decay-copied, so don't pass pointers to transient buffers.
+     * Has no effect while async mode is off.
+     */
+    void enable_deferred_formatting(bool on = true) { deferred_formatting_ = on; }
+
+    /// Number of records lost to drop_oldest/drop_newest since enable_async().
+    size_t async_dropped_count() const { return async_dropped_.load(std::memory_order_relaxed); }
+
+    // ====== Fast timestamps ======
+    /**
+     * @brief Opt-in: the Logger renders timestamps itself instead of spdlog.
+     *
+     * With the default pattern, spdlog formats "[%H:%M:%S.%f]" per message
+     * *per sink* — with stdout plus a file sink attached, every timestamp is
+     * rendered twice. With this on, the Logger prepends the timestamp (cached
+     * seconds prefix, fresh microsecond digits) and the level tag once while
+     * building the line, and the sinks are switched to a bare "%v" pattern so
+     * they write the pre-formatted buffer as-is. Output is byte-identical to
+     * the default pattern except that level coloring on terminals is lost;
+     * any custom pattern set via configure() is ignored while this is on.
+     */
+    void enable_fast_timestamps(bool on = true) {
+        std::lock_guard<std::mutex> lock(config_mutex_);
+        fast_timestamps_.store(on, std::memory_order_relaxed);
+        if (auto current = std::atomic_load_explicit(&logger_, std::memory_order_acquire)) {
+            publish_rebuilt(current->sinks());
+        } // not created yet: first emission applies effective_pattern()
+    }
+
+    // ====== Crash-safe emergency ring ======
+    /// Keeps the last @p capacity formatted records in a pre-allocated ring
+    /// (memcpy per record, never allocating) for crash-time recovery.
+    void enable_emergency_ring(size_t capacity = 256) { emergency_ring_ = std::make_unique<EmergencyRing>(capacity); }
+
+    /**
+     * @brief Installs signal handlers that dump the emergency ring on a crash.
+     *
+     * Covers SIGSEGV, SIGBUS, SIGFPE, SIGILL and SIGABRT. The handler uses
+     * only async-signal-safe write() calls against a file descriptor opened
+     * here (or stderr when @p dump_path is empty), then re-raises with the
+     * default disposition so the process still dies/cores normally. Enables
+     * the emergency ring if it isn't on yet.
+     */
+    void install_crash_handler(const std::string &dump_path = "") {
+        if (!emergency_ring_) {
+            enable_emergency_ring();
+        }
+        int fd = STDERR_FILENO;
+        if (!dump_path.empty()) {
+            int opened = ::open(dump_path.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+            if (opened >= 0) {
+                fd = opened;
+            }
+        }
+        crash_dump_fd_.store(fd, std::memory_order_relaxed);
+        crash_ring_.store(emergency_ring_.get(), std::memory_order_release);
+
+        struct sigaction action{};
+        action.sa_handler = &Logger::crash_signal_handler;
+        sigemptyset(&action.sa_mask);
+        action.sa_flags = SA_RESETHAND; // re-raise after us hits the default handler
+        for (int signo : {SIGSEGV, SIGBUS, SIGFPE, SIGILL, SIGABRT}) {
+            sigaction(signo, &action, nullptr);
+        }
+    }
+
+    // ====== Section index ======
+    /**
+     * @brief Emits a sidecar index of section boundaries next to the main log.
+     *
+     * Every section start/end appends a compact record (byte offset of the
+     * banner line in the main log, depth, name hash, timestamp) to
+     * @p file_path via an in-memory batch, letting tools seek straight to a
+     * section instead of scanning gigabytes for banners. Offsets are tracked
+     * by counting rendered bytes, so this turns on enable_fast_timestamps()
+     * (sinks then write exactly the rendered line plus a newline); enable it
+     * at setup time, before anything is logged. Under async logging with
+     * deferred formatting the offsets are best-effort; buffered sections are
+     * not indexed (their banners usually never reach the log).
+     */
+    void enable_section_index(const std::string &file_path, size_t batch_records = 256) {
+        enable_fast_timestamps();
+        section_index_ = std::make_unique<SectionIndexWriter>(file_path, batch_records);
+    }
+
+    // ====== String interning ======
+    /**
+     * @brief Interns repeated message text so the binary sink writes 4-byte IDs.
+     *
+     * Messages logged through the plain string overloads and section banners
+     * are looked up in a lock-free intern table; the first occurrence writes
+     * a one-time definition record (id + text) to the binary mmap sink, and
+     * every later occurrence writes just the id — for workloads where a few
+     * hundred distinct strings dominate, the binary file shrinks by roughly
+     * the mean message length. BinaryMmapSink::render_to_text() expands IDs
+     * transparently. Formatted messages (with arguments) vary per call and
+     * are not interned. Enable after add_binary_mmap_sink() so definitions
+     * land in the file.
+     */
+    void enable_interning(bool on = true) {
+        if (on && intern_table_ == nullptr) {
+            intern_table_ = std::make_unique<StringInternTable>();
+        } else if (!on) {
+            intern_table_.reset();
+        }
+    }
+
+    // ====== Adaptive verbosity ======
+
+    /**
+     * @brief Auto-demotes verbosity when logging itself becomes the load.
+     *
+     * During a traffic spike debug logging amplifies the overload exactly
+     * when it hurts most. With this on, the Logger tracks how many messages
+     * it emits (and how long it spends rendering them) per one-second
+     * window; when a window exceeds the budget the effective level steps up
+     * one notch (debug→info→warn, never past warn — errors always get
+     * through) and a warn line announces the shift. The level steps back
+     * down only after @p recover_windows consecutive windows below half the
+     * budget, so it doesn't flap at the boundary.
+     *
+     * The hot-path gate is untouched: demotion just stores a stricter level
+     * into the atomic that should_log() already compares against, so calls
+     * filtered out by the demoted level cost exactly one comparison, same
+     * as before. Accounting happens only on messages that actually emit —
+     * two relaxed counter bumps and a clock read next to work that already
+     * costs hundreds of nanoseconds.
+     *
+     * @param max_messages_per_sec Demote when a window emits more than this.
+     * @param max_logging_us_per_sec Additionally demote when rendering time
+     * exceeds this many microseconds per second (0 = message budget only).
+     */
+    void enable_adaptive_verbosity(uint64_t max_messages_per_sec, uint64_t max_logging_us_per_sec = 0,
+                                   int recover_windows = 3) {
+        std::lock_guard<std::mutex> lock(config_mutex_);
+        adaptive_msg_budget_ = max_messages_per_sec;
+        adaptive_us_budget_ = max_logging_us_per_sec;
+        adaptive_recover_windows_ = recover_windows;
+        base_level_.store(current_level_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        adaptive_count_.store(0, std::memory_order_relaxed);
+        adaptive_render_ns_.store(0, std::memory_order_relaxed);
+        adaptive_demotion_.store(0, std::memory_order_relaxed);
+        adaptive_quiet_windows_.store(0, std::memory_order_relaxed);
+        adaptive_window_start_ns_.store(steady_now_ns(), std::memory_order_relaxed);
+        adaptive_enabled_.store(true, std::memory_order_relaxed);
+    }
+
+    /// Turns adaptive mode off and restores the configured level.
+    void disable_adaptive_verbosity() {
+        adaptive_enabled_.store(false, std::memory_order_relaxed);
+        adaptive_demotion_.store(0, std::memory_order_relaxed);
+        apply_effective_level();
+    }
+
+    /// How many notches the level is currently demoted (0 = at the
+    /// configured level). Exposed so ops dashboards can watch for pressure.
+    int adaptive_demotion_steps() const { return adaptive_demotion_.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Returns a logger shard owned by the calling thread.
+     *
+     * The shard shares the global logger's spdlog sinks (and its async queue
+     * when async mode is on, so one collector thread merges all shards in
+     * timestamp order) but is constructed without touching spdlog's registry —
+     * no registry mutex, no uniqueness loop, just a thread_local. Each shard
+     * carries a stable "[tNN]" tag so interleaved output stays attributable,
+     * and keeps its own section depth so LogSections nest per thread.
+     */
+    static Logger &for_current_thread();
+
+    spdlog::level::level_enum get_current_level() const { return current_level_.load(std::memory_order_relaxed); }
+
+    /// The configured level, before any adaptive demotion (see
+    /// enable_adaptive_verbosity()). Save/restore code must capture this
+    /// one: feeding the demoted *effective* level back into set_level()
+    /// would quietly make a temporary demotion the new configured level.
+    spdlog::level::level_enum get_base_level() const { return base_level_.load(std::memory_order_relaxed); }
+
+    /// The hot-path gate: one relaxed atomic load and a compare. Checked at
+    /// the very top of log(), before any formatting work happens.
+    bool should_log(spdlog::level::level_enum lvl) const {
+        return lvl >= current_level_.load(std::memory_order_relaxed);
+    }
+
+    void set_level(spdlog::level::level_enum lvl) {
+        base_level_.store(lvl, std::memory_order_relaxed);
+        apply_effective_level(); // adds any adaptive demotion on top
+    }
+
+    void remove_all_sinks() {
+        std::lock_guard<std::mutex> lock(config_mutex_);
+        // called before the first emission, this just cancels the default
+        // stdout sink — the usual remove_all_sinks(); add_file_sink(...)
+        // setup never allocates a sink it throws away
+        use_default_stdout_ = false;
+        sink_patterns_.clear();
+        if (std::atomic_load_explicit(&logger_, std::memory_order_acquire) != nullptr) {
+            publish_rebuilt({});
+        }
+    }
+
+    void add_sink(std::shared_ptr<spdlog::sinks::sink> sink) {
+        std::lock_guard<std::mutex> lock(config_mutex_);
+        std::vector<spdlog::sink_ptr> sinks;
+        if (auto current = std::atomic_load_explicit(&logger_, std::memory_order_acquire)) {
+            sinks = current->sinks(); // copy, not a live reference
+        } else if (use_default_stdout_) {
+            sinks.push_back(std::make_shared<spdlog::sinks::stdout_color_sink_mt>());
+        }
+        sinks.push_back(std::move(sink));
+        publish_rebuilt(std::move(sinks));
+    }
+
+    /**
+     * @brief Attaches a sink with its own level threshold and optional pattern.
+     *
+     * Per-sink thresholds make one Logger serve roles that used to need two:
+     * a warn+ stdout sink next to a debug file sink means the message is
+     * formatted once (at the Logger's level) and a quiet sink rejects it on a
+     * single relaxed atomic compare — the cost a routing bitmask would have.
+     * Thresholds filter *within* the Logger's level: a sink can be stricter
+     * than set_level(), not more verbose. An empty @p pattern inherits the
+     * Logger-wide one; per-sink patterns survive sink-set rebuilds but are
+     * overridden by enable_fast_timestamps(), which pre-renders everything.
+     */
+    void add_sink(std::shared_ptr<spdlog::sinks::sink> sink, spdlog::level::level_enum threshold,
+                  std::string_view pattern = "") {
+        sink->set_level(threshold);
+        if (!pattern.empty()) {
+            std::lock_guard<std::mutex> lock(config_mutex_);
+            sink_patterns_[sink.get()] = std::string(pattern);
+        }
+        add_sink(std::move(sink));
+    }
+
+    void add_file_sink(const std::string &file_path, bool overwrite_file = true) {
+        auto file_sink = std::make_shared<spdlog::sinks::basic_file_sink_mt>(file_path, overwrite_file);
+        add_sink(file_sink);
+    }
+
+    /// File sink with its own threshold/pattern (see the add_sink overload).
+    void add_file_sink(const std::string &file_path, spdlog::level::level_enum threshold,
+                       std::string_view pattern = "", bool overwrite_file = true) {
+        auto file_sink = std::make_shared<spdlog::sinks::basic_file_sink_mt>(file_path, overwrite_file);
+        add_sink(file_sink, threshold, pattern);
+    }
+
+    /**
+     * @brief Attaches a binary memory-mapped sink alongside the text sinks.
+     *
+     * Every message additionally lands in @p file_path as a packed binary
+     * record (timestamp, level, section depth, raw message) at memcpy cost;
+     * use BinaryMmapSink::render_to_text() to get the text form offline.
+     *
+     * @param capacity_bytes Size the mapping is created with; writing stops
+     * when it fills. The file is truncated to the bytes used on destruction.
+     */
+    void add_binary_mmap_sink(const std::string &file_path, size_t capacity_bytes) {
+        binary_sink_ = std::make_shared<BinaryMmapSink>(file_path, capacity_bytes);
+    }
+
+    void remove_binary_mmap_sink() { binary_sink_.reset(); }
+
+    /**
+     * @brief Attaches a file sink that compresses its output as streaming zstd.
+     *
+     * The file is a standard .zst stream (`zstd -d` reads it); frames close
+     * every ~1 MiB of input so readers can decompress from frame boundaries.
+     * Formatting happens on the logging thread as usual, but compression and
+     * file I/O run on the sink's own thread fed by batched buffers, so the
+     * hot-path cost over a plain file sink is one in-memory append.
+     *
+     * @param lvl Only messages at/above this level reach the compressed file;
+     * other sinks are unaffected.
+     */
+    void add_compressed_file_sink(const std::string &file_path, spdlog::level::level_enum lvl = spdlog::level::trace) {
+        auto compressed_sink = std::make_shared<CompressedFileSink>(file_path);
+        compressed_sink->set_level(lvl);
+        add_sink(compressed_sink);
+    }
+
+    /**
+     * @brief Routes this process's output through shared memory to a collector.
+     *
+     * Creates a per-process SPSC segment under @p region_name; run the
+     * logger_shm_collector binary with the same region name to merge all
+     * processes' records by timestamp into one stream. Logging never blocks
+     * on the collector — a full ring drops records (see
+     * ShmLogSink::dropped_count()). Typically paired with remove_all_sinks()
+     * so worker processes do no file I/O of their own.
+     */
+    void add_shm_sink(const std::string &region_name, size_t capacity_bytes = 1 << 20) {
+        add_sink(std::make_shared<ShmLogSink>(region_name, capacity_bytes));
+    }
+
+    void add_rotating_file_sink(const std::string &file_path, size_t max_size, size_t max_files) {
+        auto rotating_sink = std::make_shared<spdlog::sinks::rotating_file_sink_mt>(file_path, max_size, max_files);
+        add_sink(rotating_sink);
+    }
+
+    void add_stdout_sink(bool color = true) {
+        if (color) {
+            add_sink(std::make_shared<spdlog::sinks::stdout_color_sink_mt>());
+        } else {
+            add_sink(std::make_shared<spdlog::sinks::stdout_sink_mt>());
+        }
+    }
+
+    /// Stdout sink with its own threshold — the "quiet console next to a
+    /// verbose file" setup in one Logger (see the add_sink overload).
+    void add_stdout_sink(spdlog::level::level_enum threshold, bool color = true) {
+        std::shared_ptr<spdlog::sinks::sink> stdout_sink;
+        if (color) {
+            stdout_sink = std::make_shared<spdlog::sinks::stdout_color_sink_mt>();
+        } else {
+            stdout_sink = std::make_shared<spdlog::sinks::stdout_sink_mt>();
+        }
+        add_sink(std::move(stdout_sink), threshold);
+    }
+
+    // ====== Flush batching ======
+    /// When any trigger is at its zero value it is disabled; with no triggers
+    /// set the Logger never flushes explicitly (spdlog's default behavior).
+    struct FlushPolicy {
+        size_t every_n_messages = 0;                 ///< flush after this many messages
+        std::chrono::milliseconds every_duration{0}; ///< flush when this much time passed since the last one
+        spdlog::level::level_enum on_level = spdlog::level::off; ///< always flush at/above this level
+    };
+
+    /**
+     * @brief Coalesces sink flushes instead of leaving them to the sinks.
+     *
+     * Bursts of messages (including the lines of one multi-line message) are
+     * accumulated in the sinks' buffers and pushed to disk in one flush when a
+     * trigger fires. In async mode the worker additionally flushes once per
+     * drained burst rather than per record, so a 50-line dump costs one flush.
+     * A typical production setting: every 256 messages, every 500 ms, and
+     * immediately on warn and above.
+     */
+    void flush_policy(size_t every_n_messages, std::chrono::milliseconds every_duration,
+                      spdlog::level::level_enum on_level = spdlog::level::warn) {
+        flush_policy_.every_n_messages = every_n_messages;
+        flush_policy_.every_duration = every_duration;
+        flush_policy_.on_level = on_level;
+        last_flush_ns_.store(steady_now_ns(), std::memory_order_relaxed);
+    }
+
+    /// Flushes all sinks immediately and resets the batching triggers.
+    void flush() {
+        messages_since_flush_.store(0, std::memory_order_relaxed);
+        last_flush_ns_.store(steady_now_ns(), std::memory_order_relaxed);
+        if (auto snapshot = existing_snapshot()) {
+            snapshot->flush();
+        }
+        if (section_index_ != nullptr) {
+            section_index_->flush();
+        }
+    }
+
+    void configure(spdlog::level::level_enum lvl, std::string_view pattern) {
+        std::lock_guard<std::mutex> lock(config_mutex_);
+        current_level_.store(lvl, std::memory_order_relaxed);
+        current_pattern_ = std::string(pattern);
+        if (auto current = std::atomic_load_explicit(&logger_, std::memory_order_acquire)) {
+            publish_rebuilt(current->sinks());
+        } // not created yet: first emission applies the stored level/pattern
+    }
+
+    // ====== Logging core ======
+    // Format-string overload (compile-time checked). Formats into a reused
+    // per-thread buffer so the common single-line call never touches the heap.
+    template <typename... Args>
+    void log(spdlog::level::level_enum lvl, fmt::format_string<Args...> fmt_str, Args &&...args) {
+        if (!should_log(lvl)) {
+            return; // one branch; no formatting, no lookups
+        }
+        // thread shards always format eagerly so their tag is baked into the
+        // text, and buffered sections must capture the rendered line now
+        if (deferred_formatting_ && async_parent_ == nullptr && active_capture() == nullptr &&
+            async_running_.load(std::memory_order_acquire)) {
+            LogRecordRingBuffer::Record record;
+            record.lvl = lvl;
+            record.section_depth = section_depth_;
+            record.deferred.capture(fmt::string_view(fmt_str), std::forward<Args>(args)...);
+            push_record(std::move(record));
+            return;
+        }
+        thread_local fmt::memory_buffer format_buffer;
+        format_buffer.clear();
+        fmt::format_to(std::back_inserter(format_buffer), fmt_str, std::forward<Args>(args)...);
+        format_and_log(lvl, std::string_view(format_buffer.data(), format_buffer.size()));
+    }
+
+    // Direct runtime string overload
+    void log(spdlog::level::level_enum lvl, std::string_view msg) {
+        if (!should_log(lvl)) {
+            return;
+        }
+        // callers of this overload pass stable text, the interning sweet spot
+        format_and_log(lvl, msg, /*internable=*/true);
+    }
+
+    /**
+     * @brief Annotates every wrapper call with its "file:line: " origin.
+     *
+     * The location string for each call site is built once and cached in the
+     * call-site table, so with this on a located log call costs one extra
+     * atomic load and a buffer append over a plain one — no spdlog pattern
+     * change, no per-message location formatting. Composes with section bars:
+     * the label leads the message text, after the prefix machinery.
+     */
+    void enable_source_location(bool on = true) { source_location_enabled_ = on; }
+
+    /**
+     * @brief Opt-in per-call-site cost accounting for the convenience wrappers.
+     *
+     * While on, every wrapper call records its count, bytes formatted and
+     * nanoseconds spent in formatting plus sink hand-off into its call-site
+     * entry (one cache line per site, so unrelated call sites never contend).
+     * dump_stats() reports the accumulated numbers.
+     */
+    void enable_stats(bool on = true) { stats_enabled_ = on; }
+
+    /// Logs a per-call-site cost report, most expensive call sites first.
+    void dump_stats() {
+        struct Row {
+            const char *label;
+            uint64_t count;
+            uint64_t bytes;
+            uint64_t ns;
+        };
+        std::vector<Row> rows;
+        call_sites_.for_each([&](CallSiteRegistry::Entry &entry) {
+            uint64_t count = entry.stat_count.load(std::memory_order_relaxed);
+            if (count == 0) {
+                return;
+            }
+            const char *label = entry.location_label.load(std::memory_order_acquire);
+            rows.push_back({label != nullptr ? label : "<unknown site>", count,
+                            entry.stat_bytes.load(std::memory_order_relaxed),
+                            entry.stat_ns.load(std::memory_order_relaxed)});
+        });
+        std::sort(rows.begin(), rows.end(), [](const Row &a, const Row &b) { return a.ns > b.ns; });
+
+        info("=== call-site logging cost report ({} sites) ===", rows.size());
+        for (const Row &row : rows) {
+            // the cached label already ends with ": "
+            info("{}count={} bytes={} total_us={:.1f} avg_ns={}", row.label, row.count, row.bytes,
+                 row.ns / 1000.0, row.count > 0 ? row.ns / row.count : 0);
+        }
+    }
+
+    /// True when calls at @p lvl survive LOGGER_COMPILE_TIME_LEVEL stripping.
+    static constexpr bool compiled_in(spdlog::level::level_enum lvl) {
+        return static_cast<int>(lvl) >= LOGGER_COMPILE_TIME_LEVEL;
+    }
+
+    // ====== Convenience wrappers ======
+    // Each wrapper is gated on the compile-time level with `if constexpr`, so
+    // stripped levels leave an empty inline body the optimizer deletes along
+    // with (pure) argument expressions at the call site.
+    template <typename... Args> void trace(loc_format_string<Args...> fmt_str, Args &&...args) {
+        if constexpr (compiled_in(spdlog::level::trace)) {
+            log_located(spdlog::level::trace, fmt_str, std::forward<Args>(args)...);
+        }
+    }
+    void trace(std::string_view msg) {
+        if constexpr (compiled_in(spdlog::level::trace)) {
+            log(spdlog::level::trace, msg);
+        }
+    }
+
+    template <typename... Args> void debug(loc_format_string<Args...> fmt_str, Args &&...args) {
+        if constexpr (compiled_in(spdlog::level::debug)) {
+            log_located(spdlog::level::debug, fmt_str, std::forward<Args>(args)...);
+        }
+    }
+    void debug(std::string_view msg) {
+        if constexpr (compiled_in(spdlog::level::debug)) {
+            log(spdlog::level::debug, msg);
+        }
+    }
 
-#include "sbpt_generated_includes.hpp"
+    template <typename... Args> void info(loc_format_string<Args...> fmt_str, Args &&...args) {
+        if constexpr (compiled_in(spdlog::level::info)) {
+            log_located(spdlog::level::info, fmt_str, std::forward<Args>(args)...);
+        }
+    }
+    void info(std::string_view msg) {
+        if constexpr (compiled_in(spdlog::level::info)) {
+            log(spdlog::level::info, msg);
+        }
+    }
 
-const std::map<spdlog::level::level_enum, std::string> level_to_string = {
-    {spdlog::level::trace, "trace"},  {spdlog::level::debug, "debug"}, {spdlog::level::info, "info"},
-    {spdlog::level::warn, "warning"}, {spdlog::level::err, "error"},   {spdlog::level::critical, "critical"},
-    {spdlog::level::off, "off"}};
+    template <typename... Args> void warn(loc_format_string<Args...> fmt_str, Args &&...args) {
+        if constexpr (compiled_in(spdlog::level::warn)) {
+            log_located(spdlog::level::warn, fmt_str, std::forward<Args>(args)...);
+        }
+    }
+    void warn(std::string_view msg) {
+        if constexpr (compiled_in(spdlog::level::warn)) {
+            log(spdlog::level::warn, msg);
+        }
+    }
 
-// NOTE: this is replacing everything else.
-class Logger {
-  public:
-    explicit Logger(std::string_view base_name = "section_logger")
-        : section_depth_(0), current_level_(spdlog::level::debug), current_pattern_("[%H:%M:%S.%f] [%^%l%$] %v") {
-        std::string logger_name = std::string(base_name);
+    template <typename... Args> void error(loc_format_string<Args...> fmt_str, Args &&...args) {
+        if constexpr (compiled_in(spdlog::level::err)) {
+            log_located(spdlog::level::err, fmt_str, std::forward<Args>(args)...);
+        }
+    }
+    void error(std::string_view msg) {
+        if constexpr (compiled_in(spdlog::level::err)) {
+            log(spdlog::level::err, msg);
+        }
+    }
 
-        // If logger exists, increment postfix until unique
-        int counter = 1;
-        while (spdlog::get(logger_name) != nullptr) {
-            logger_name = std::string(base_name) + "_" + std::to_string(counter++);
+    template <typename... Args> void critical(loc_format_string<Args...> fmt_str, Args &&...args) {
+        if constexpr (compiled_in(spdlog::level::critical)) {
+            log_located(spdlog::level::critical, fmt_str, std::forward<Args>(args)...);
+        }
+    }
+    void critical(std::string_view msg) {
+        if constexpr (compiled_in(spdlog::level::critical)) {
+            log(spdlog::level::critical, msg);
         }
+    }
 
-        auto stdout_sink = std::make_shared<spdlog::sinks::stdout_color_sink_mt>();
-        logger_ = std::make_shared<spdlog::logger>(logger_name, stdout_sink);
-        spdlog::register_logger(logger_);
+    // ====== Rate-limited logging ======
+    // Per-call-site variants for call sites that can flood (tight loops,
+    // per-tick error paths). The call site is identified by its captured
+    // source location; a suppressed call costs two relaxed atomic bumps.
+    // When a message does go out after suppressions, a
+    // "(suppressed N earlier occurrences)" note is appended.
 
-        configure(current_level_, current_pattern_);
+    /// Logs on the 1st, (n+1)th, (2n+1)th... call from this call site.
+    template <typename... Args>
+    void log_every_n(uint64_t n, spdlog::level::level_enum lvl, loc_format_string<Args...> fmt_str, Args &&...args) {
+        if (!should_log(lvl)) {
+            return; // level-gated like the plain wrappers; rate limiting only
+                    // decides among calls that would log at all
+        }
+        CallSiteRegistry::Entry &site = call_sites_.entry_for(fmt_str.loc);
+        uint64_t hit = site.hits.fetch_add(1, std::memory_order_relaxed);
+        if (n > 1 && hit % n != 0) {
+            site.suppressed.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        log_with_suppressed_note(site, lvl, fmt_str.fmt, std::forward<Args>(args)...);
     }
 
-    spdlog::level::level_enum get_current_level() const { return current_level_; }
+    /// Logs only the first n calls from this call site.
+    template <typename... Args>
+    void log_first_n(uint64_t n, spdlog::level::level_enum lvl, loc_format_string<Args...> fmt_str, Args &&...args) {
+        if (!should_log(lvl)) {
+            return;
+        }
+        CallSiteRegistry::Entry &site = call_sites_.entry_for(fmt_str.loc);
+        uint64_t hit = site.hits.fetch_add(1, std::memory_order_relaxed);
+        if (hit >= n) {
+            site.suppressed.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        log_with_suppressed_note(site, lvl, fmt_str.fmt, std::forward<Args>(args)...);
+    }
 
-    void set_level(spdlog::level::level_enum lvl) {
-        current_level_ = lvl;
-        logger_->set_level(lvl);
+    /// Logs at most once per @p min_interval from this call site.
+    template <typename... Args>
+    void log_at_most_every(std::chrono::nanoseconds min_interval, spdlog::level::level_enum lvl,
+                           loc_format_string<Args...> fmt_str, Args &&...args) {
+        if (!should_log(lvl)) {
+            return;
+        }
+        CallSiteRegistry::Entry &site = call_sites_.entry_for(fmt_str.loc);
+        int64_t now =
+            std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+                .count();
+        int64_t last = site.last_emit_ns.load(std::memory_order_relaxed);
+        // CAS picks a single winner per window when multiple threads race
+        if (now - last < min_interval.count() ||
+            !site.last_emit_ns.compare_exchange_strong(last, now, std::memory_order_relaxed)) {
+            site.suppressed.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        log_with_suppressed_note(site, lvl, fmt_str.fmt, std::forward<Args>(args)...);
     }
 
-    void remove_all_sinks() { logger_->sinks().clear(); }
+    // ====== Structured events ======
+    /**
+     * @brief Logs a structured key-value event, e.g.
+     * `logger.event("tick_done", kv("frame", n), kv("ms", dt))`.
+     *
+     * With a binary mmap sink attached the event is encoded straight into a
+     * compact length-prefixed record (no number-to-text round trip; the
+     * analysis side reads values back out of the mmap directly, and
+     * BinaryMmapSink::render_to_text() shows them as "event NAME key=value").
+     * Without one it degrades to a readable "event NAME key=value ..." text
+     * line through the normal pipeline so events are never silently lost.
+     */
+    template <typename... Fields> void event(std::string_view name, const Fields &...fields) {
+        if (!should_log(spdlog::level::info)) {
+            return;
+        }
+        if (binary_sink_) {
+            thread_local fmt::memory_buffer event_buffer;
+            event_buffer.clear();
+            append_length_prefixed(event_buffer, name);
+            append_raw(event_buffer, static_cast<uint32_t>(sizeof...(Fields)));
+            (encode_field(event_buffer, fields), ...);
+            binary_sink_->write(spdlog::level::info, section_depth_,
+                                std::string_view(event_buffer.data(), event_buffer.size()),
+                                BinaryMmapSink::kind_event);
+            return;
+        }
+        thread_local fmt::memory_buffer event_text_buffer;
+        event_text_buffer.clear();
+        event_text_buffer.append(std::string_view("event "));
+        event_text_buffer.append(name);
+        (fmt::format_to(std::back_inserter(event_text_buffer), " {}={}", fields.key, fields.value), ...);
+        format_and_log(spdlog::level::info, std::string_view(event_text_buffer.data(), event_text_buffer.size()));
+    }
 
-    void add_sink(std::shared_ptr<spdlog::sinks::sink> sink) {
-        logger_->sinks().push_back(sink);
-        reapply_formatting(); // <-- ensure new sink matches
+    // Sections still require formatting, but you could add overloads too if you want.
+    template <typename... Args> void start_section(fmt::format_string<Args...> fmt_str, Args &&...args) {
+        start_section(spdlog::level::info, fmt_str, std::forward<Args>(args)...);
+    }
+    template <typename... Args>
+    void start_section(spdlog::level::level_enum lvl, fmt::format_string<Args...> fmt_str, Args &&...args) {
+        std::string name = fmt::format(fmt_str, std::forward<Args>(args)...);
+        if (should_log(lvl)) {
+            record_section_boundary(SectionIndexWriter::kind_start, section_depth_, name);
+        }
+        log(lvl, "=== start {} === {{", name);
+        ++section_depth_;
+    }
+    template <typename... Args> void end_section(fmt::format_string<Args...> fmt_str, Args &&...args) {
+        end_section(spdlog::level::info, fmt_str, std::forward<Args>(args)...);
+    }
+    template <typename... Args>
+    void end_section(spdlog::level::level_enum lvl, fmt::format_string<Args...> fmt_str, Args &&...args) {
+        if (section_depth_ > 0)
+            --section_depth_;
+        std::string name = fmt::format(fmt_str, std::forward<Args>(args)...);
+        if (should_log(lvl)) {
+            record_section_boundary(SectionIndexWriter::kind_end, section_depth_, name);
+        }
+        log(lvl, "===   end {} === }}", name);
     }
 
-    void add_file_sink(const std::string &file_path, bool overwrite_file = true) {
-        auto file_sink = std::make_shared<spdlog::sinks::basic_file_sink_mt>(file_path, overwrite_file);
-        add_sink(file_sink);
+    /// Allocation-free start_section: builds the banner with buffer appends
+    /// instead of a fmt::format round-trip. Used by LogSection.
+    void start_section_direct(spdlog::level::level_enum lvl, std::string_view name) {
+        if (should_log(lvl)) {
+            record_section_boundary(SectionIndexWriter::kind_start, section_depth_, name);
+            thread_local fmt::memory_buffer section_buffer;
+            section_buffer.clear();
+            section_buffer.append(std::string_view("=== start "));
+            section_buffer.append(name);
+            section_buffer.append(std::string_view(" === {"));
+            format_and_log(lvl, std::string_view(section_buffer.data(), section_buffer.size()),
+                           /*internable=*/true);
+        }
+        ++section_depth_;
     }
 
-    void add_rotating_file_sink(const std::string &file_path, size_t max_size, size_t max_files) {
-        auto rotating_sink = std::make_shared<spdlog::sinks::rotating_file_sink_mt>(file_path, max_size, max_files);
-        add_sink(rotating_sink);
+    /// Allocation-free end_section counterpart of start_section_direct().
+    void end_section_direct(spdlog::level::level_enum lvl, std::string_view name) {
+        if (section_depth_ > 0)
+            --section_depth_;
+        if (should_log(lvl)) {
+            record_section_boundary(SectionIndexWriter::kind_end, section_depth_, name);
+            thread_local fmt::memory_buffer section_buffer;
+            section_buffer.clear();
+            section_buffer.append(std::string_view("===   end "));
+            section_buffer.append(name);
+            section_buffer.append(std::string_view(" === }"));
+            format_and_log(lvl, std::string_view(section_buffer.data(), section_buffer.size()),
+                           /*internable=*/true);
+        }
     }
 
-    void add_stdout_sink(bool color = true) {
-        if (color) {
-            add_sink(std::make_shared<spdlog::sinks::stdout_color_sink_mt>());
+    /// end_section variant used by timed LogSections: appends the elapsed time.
+    void end_section_with_elapsed(spdlog::level::level_enum lvl, std::string_view name, double elapsed_ms) {
+        if (section_depth_ > 0)
+            --section_depth_;
+        if (should_log(lvl)) {
+            record_section_boundary(SectionIndexWriter::kind_end, section_depth_, name);
+        }
+        log(lvl, "===   end {} === }} [{:.3f}ms]", name, elapsed_ms);
+    }
+
+    void disable_all_levels() { set_level(spdlog::level::off); }
+
+    void enable_all_levels() { set_level(spdlog::level::trace); }
+
+    // ====== Buffered sections (see LogSection::LogMode::buffered) ======
+    /// Capture target for a buffered section: rendered lines laid out back to
+    /// back in one arena, plus level and length per line for replay.
+    struct SectionBuffer {
+        fmt::memory_buffer arena;
+        std::vector<std::pair<spdlog::level::level_enum, uint32_t>> records;
+    };
+
+    /// Redirects subsequent messages into @p buffer instead of the sinks.
+    /// Returns the previously active buffer so buffered sections can nest.
+    /// One capture slot per *thread*, tagged with the Logger that owns it.
+    /// A LogMode::buffered section only redirects messages from the thread
+    /// that opened it; other threads sharing the Logger keep logging straight
+    /// to the sinks — no cross-thread arena appends, no swallowed messages.
+    struct ThreadCapture {
+        const Logger *owner = nullptr;
+        SectionBuffer *buffer = nullptr;
+    };
+
+    ThreadCapture begin_buffered_section(SectionBuffer &buffer) {
+        ThreadCapture &capture = thread_capture();
+        ThreadCapture previous = capture;
+        capture = ThreadCapture{this, &buffer};
+        return previous;
+    }
+
+    void end_buffered_section(const ThreadCapture &previous) { thread_capture() = previous; }
+
+    /// Replays a captured section in order. When a buffered section nests
+    /// inside another, the replay lands in the enclosing buffer, so the inner
+    /// section's fate follows the outer one's.
+    void flush_buffered_section(const SectionBuffer &buffer) {
+        const char *cursor = buffer.arena.data();
+        spdlog::level::level_enum max_lvl = spdlog::level::trace;
+        for (auto [lvl, length] : buffer.records) {
+            emit(lvl, std::string_view(cursor, length));
+            max_lvl = std::max(max_lvl, lvl);
+            cursor += length;
+        }
+        // emit() doesn't flush per record; one decision for the replay
+        if (!buffer.records.empty()) {
+            maybe_flush_sync(max_lvl, buffer.records.size());
+        }
+    }
+
+  private:
+    // ====== Structured event encoding ======
+    template <typename T> static void append_raw(fmt::memory_buffer &buf, const T &value) {
+        const char *bytes = reinterpret_cast<const char *>(&value);
+        buf.append(bytes, bytes + sizeof(T));
+    }
+
+    static void append_length_prefixed(fmt::memory_buffer &buf, std::string_view s) {
+        append_raw(buf, static_cast<uint32_t>(s.size()));
+        buf.append(s);
+    }
+
+    /// Encodes one field as key (length-prefixed) + type tag + value bytes.
+    template <typename T> static void encode_field(fmt::memory_buffer &buf, const KeyValue<T> &field) {
+        append_length_prefixed(buf, field.key);
+        if constexpr (std::is_same_v<T, bool>) {
+            buf.push_back('b');
+            buf.push_back(field.value ? char(1) : char(0));
+        } else if constexpr (std::is_integral_v<T> && std::is_signed_v<T>) {
+            buf.push_back('i');
+            append_raw(buf, static_cast<int64_t>(field.value));
+        } else if constexpr (std::is_integral_v<T>) {
+            buf.push_back('u');
+            append_raw(buf, static_cast<uint64_t>(field.value));
+        } else if constexpr (std::is_floating_point_v<T>) {
+            buf.push_back('d');
+            append_raw(buf, static_cast<double>(field.value));
         } else {
-            add_sink(std::make_shared<spdlog::sinks::stdout_sink_mt>());
+            buf.push_back('s');
+            append_length_prefixed(buf, std::string_view(field.value));
         }
     }
 
-    void configure(spdlog::level::level_enum lvl, std::string_view pattern) {
-        current_level_ = lvl;
-        current_pattern_ = std::string(pattern);
-        reapply_formatting();
+    /// Wrapper backend: routes through the plain path unless source-location
+    /// annotation is on, in which case the cached call-site label is prepended.
+    template <typename... Args>
+    void log_located(spdlog::level::level_enum lvl, loc_format_string<Args...> &fmt_str, Args &&...args) {
+        if (!source_location_enabled_ && !stats_enabled_) {
+            log(lvl, fmt_str.fmt, std::forward<Args>(args)...);
+            return;
+        }
+        if (!should_log(lvl)) {
+            return;
+        }
+        CallSiteRegistry::Entry &site = call_sites_.entry_for(fmt_str.loc);
+        const char *label = CallSiteRegistry::location_label_for(site, fmt_str.loc);
+        int64_t start_ns = stats_enabled_ ? steady_now_ns() : 0;
+
+        thread_local fmt::memory_buffer located_buffer;
+        located_buffer.clear();
+        if (source_location_enabled_) {
+            located_buffer.append(std::string_view(label));
+        }
+        fmt::format_to(std::back_inserter(located_buffer), fmt_str.fmt, std::forward<Args>(args)...);
+        format_and_log(lvl, std::string_view(located_buffer.data(), located_buffer.size()));
+
+        if (stats_enabled_) {
+            site.stat_count.fetch_add(1, std::memory_order_relaxed);
+            site.stat_bytes.fetch_add(located_buffer.size(), std::memory_order_relaxed);
+            site.stat_ns.fetch_add(static_cast<uint64_t>(steady_now_ns() - start_ns), std::memory_order_relaxed);
+        }
     }
 
-    // ====== Logging core ======
-    // Format-string overload (compile-time checked)
+    /// Tag type selecting the thread-shard constructor.
+    struct ThreadShard {};
+
+    /**
+     * @brief Shard constructor: shares the parent's sinks, skips the registry.
+     *
+     * Deliberately does not create or register an spdlog logger — the shard
+     * reuses the parent's, so construction is a couple of member copies plus
+     * one atomic bump for the thread tag.
+     *
+     * The level is snapshotted once here and never resynced: a later
+     * set_level() on the parent does not reach existing shards, and a
+     * shard's own set_level() adjusts only its private gate (the shared
+     * spdlog logger keeps the parent's level, so a shard can mute itself
+     * but not outlog the parent). Per-thread level control is the point;
+     * process-wide changes belong on the parent before shards are spun up.
+     */
+    Logger(ThreadShard, Logger &parent) : section_depth_(0), current_level_(parent.get_current_level()) {
+        async_parent_ = &parent;
+        base_level_.store(current_level_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        {
+            // logger_ and the pattern are mutated under the parent's config
+            // mutex; copy them under the same lock so shard creation can race
+            // with configure()/add_sink() on other threads.
+            std::lock_guard<std::mutex> lock(parent.config_mutex_);
+            logger_ = parent.logger_;
+            current_pattern_ = parent.current_pattern_;
+        }
+        static std::atomic<int> next_thread_tag{0};
+        thread_tag_ = fmt::format("[t{:02}] ", next_thread_tag.fetch_add(1, std::memory_order_relaxed));
+    }
+
+    /// Formats the message, appending a suppression summary when earlier
+    /// calls from this site were rate-limited away.
     template <typename... Args>
-    void log(spdlog::level::level_enum lvl, fmt::format_string<Args...> fmt_str, Args &&...args) {
-        format_and_log(lvl, fmt::format(fmt_str, std::forward<Args>(args)...));
+    void log_with_suppressed_note(CallSiteRegistry::Entry &site, spdlog::level::level_enum lvl,
+                                  fmt::format_string<Args...> fmt_str, Args &&...args) {
+        uint64_t suppressed = site.suppressed.exchange(0, std::memory_order_relaxed);
+        thread_local fmt::memory_buffer rate_limit_buffer;
+        rate_limit_buffer.clear();
+        fmt::format_to(std::back_inserter(rate_limit_buffer), fmt_str, std::forward<Args>(args)...);
+        if (suppressed > 0) {
+            fmt::format_to(std::back_inserter(rate_limit_buffer), " (suppressed {} earlier occurrences)", suppressed);
+        }
+        format_and_log(lvl, std::string_view(rate_limit_buffer.data(), rate_limit_buffer.size()));
     }
 
-    // Direct runtime string overload
-    void log(spdlog::level::level_enum lvl, std::string_view msg) { format_and_log(lvl, std::string(msg)); }
+    void format_and_log(spdlog::level::level_enum lvl, std::string_view msg, bool internable = false) {
+        Logger *owner = const_cast<Logger *>(sink_owner());
+        if (!owner->adaptive_enabled_.load(std::memory_order_relaxed)) {
+            render_lines(lvl, msg, section_depth_, /*force_sync=*/false, internable);
+            return;
+        }
+        auto render_start = std::chrono::steady_clock::now();
+        render_lines(lvl, msg, section_depth_, /*force_sync=*/false, internable);
+        owner->adaptive_account(render_start);
+    }
 
-    // ====== Convenience wrappers ======
-    template <typename... Args> void trace(fmt::format_string<Args...> fmt_str, Args &&...args) {
-        log(spdlog::level::trace, fmt_str, std::forward<Args>(args)...);
+    /**
+     * @brief Splits @p msg on newlines and emits each line with padding and section bars.
+     *
+     * @param depth Section depth to prefix with (captured at call time for deferred records).
+     * @param force_sync When true, lines go straight to the sinks even in async
+     * mode — used by the worker thread, which must never re-enqueue.
+     */
+    void render_lines(spdlog::level::level_enum lvl, std::string_view msg, int depth, bool force_sync,
+                      bool internable = false) {
+        // binary sink gets the whole raw message once, before line splitting;
+        // static text it has seen before collapses to a 4-byte intern id.
+        // Not while a buffered section is capturing: its contract is that a
+        // discarded section hits no sink at all, and the binary file is a
+        // sink like any other. (Known limitation: a *committed* section's
+        // interior replays as rendered text lines and is not re-encoded into
+        // the binary log — only its surroundings appear there.)
+        if (binary_sink_ && active_capture() == nullptr) {
+            StringInternTable::InternResult interned{0, false};
+            if (internable && intern_table_ != nullptr) {
+                interned = intern_table_->intern(msg);
+            }
+            if (interned.id != 0) {
+                if (interned.first_occurrence) {
+                    binary_sink_->write_intern_def(interned.id, msg);
+                }
+                binary_sink_->write_interned(lvl, depth, interned.id);
+            } else {
+                binary_sink_->write(lvl, depth, msg);
+            }
+        }
+
+        // Padding is precomputed per level; this is a single indexed load.
+        std::string_view padding = level_padding[static_cast<size_t>(lvl)];
+
+        if (msg.empty()) {
+            return;
+        }
+
+        // The padding + tag + bars prefix is identical for every line of this
+        // message, so build it once; each line is then a resize back to the
+        // prefix plus a single sized append (one memcpy) into the reused
+        // per-thread buffer. Newlines are found with memchr, one pass over
+        // the bytes, no temporary strings.
+        thread_local fmt::memory_buffer line_buffer;
+        line_buffer.clear();
+        // Shards follow their parent's rendering mode, like the sink set.
+        if (sink_owner()->fast_timestamps_.load(std::memory_order_relaxed)) {
+            thread_local TimestampCache timestamp_cache;
+            timestamp_cache.append_now(line_buffer);
+            line_buffer.push_back('[');
+            line_buffer.append(level_to_string[static_cast<size_t>(lvl)]);
+            line_buffer.append(std::string_view("] "));
+        }
+        line_buffer.append(padding);
+        line_buffer.append(std::string_view(thread_tag_)); // empty unless this is a thread shard
+        line_buffer.append(section_prefix_for_depth(depth));
+        // depths beyond the precomputed table (rare) fall back to appending
+        for (int i = static_cast<int>(max_precomputed_section_depth); i < depth; ++i) {
+            line_buffer.append(std::string_view("| "));
+        }
+        const size_t prefix_len = line_buffer.size();
+
+        const char *cursor = msg.data();
+        const char *const end = msg.data() + msg.size();
+        size_t line_count = 0;
+        while (cursor < end) {
+            const char *newline = static_cast<const char *>(std::memchr(cursor, '\n', end - cursor));
+            std::string_view line(cursor, newline != nullptr ? newline - cursor : end - cursor);
+
+            line_buffer.resize(prefix_len);
+            line_buffer.append(line);
+            std::string_view full_msg(line_buffer.data(), line_buffer.size());
+            if (emergency_ring_) {
+                emergency_ring_->write(lvl, full_msg);
+            }
+            if (force_sync) {
+                count_main_log_bytes(full_msg);
+                sink_snapshot()->log(lvl, full_msg);
+            } else {
+                emit(lvl, full_msg);
+            }
+            ++line_count;
+
+            if (newline == nullptr) {
+                break;
+            }
+            cursor = newline + 1;
+        }
+        // one flush decision for the whole message; the force_sync (worker)
+        // path is covered by the drain loop's per-burst decision instead
+        if (!force_sync && active_capture() == nullptr && line_count > 0) {
+            maybe_flush_sync(lvl, line_count);
+        }
     }
-    void trace(std::string_view msg) { log(spdlog::level::trace, msg); }
 
-    template <typename... Args> void debug(fmt::format_string<Args...> fmt_str, Args &&...args) {
-        log(spdlog::level::debug, fmt_str, std::forward<Args>(args)...);
+    /// Tracks the main log's write position for the section index (+1 for the
+    /// newline every sink appends). No-op unless the index is enabled.
+    void count_main_log_bytes(std::string_view full_msg) {
+        const Logger *owner = sink_owner();
+        if (owner->section_index_ != nullptr) {
+            const_cast<Logger *>(owner)->main_log_bytes_.fetch_add(full_msg.size() + 1, std::memory_order_relaxed);
+        }
     }
-    void debug(std::string_view msg) { log(spdlog::level::debug, msg); }
 
-    template <typename... Args> void info(fmt::format_string<Args...> fmt_str, Args &&...args) {
-        log(spdlog::level::info, fmt_str, std::forward<Args>(args)...);
+    /// Appends a section boundary to the sidecar index. Called before the
+    /// banner line is rendered, so the offset points at the banner itself.
+    void record_section_boundary(SectionIndexWriter::RecordKind kind, int depth, std::string_view name) {
+        Logger *owner = const_cast<Logger *>(sink_owner());
+        if (owner->section_index_ != nullptr && active_capture() == nullptr) {
+            owner->section_index_->append(owner->main_log_bytes_.load(std::memory_order_relaxed), depth, name, kind);
+        }
     }
-    void info(std::string_view msg) { log(spdlog::level::info, msg); }
 
-    template <typename... Args> void warn(fmt::format_string<Args...> fmt_str, Args &&...args) {
-        log(spdlog::level::warn, fmt_str, std::forward<Args>(args)...);
+    /// Recomputes the gate level as base + adaptive demotion, capped at warn.
+    /// Everything downstream (should_log, the spdlog logger) reads this one
+    /// atomic, so a shift is visible on the very next gated call.
+    void apply_effective_level() {
+        auto base = base_level_.load(std::memory_order_relaxed);
+        auto effective = base;
+        int demotion = adaptive_enabled_.load(std::memory_order_relaxed)
+                           ? adaptive_demotion_.load(std::memory_order_relaxed)
+                           : 0;
+        if (demotion > 0 && base < spdlog::level::warn) {
+            effective = static_cast<spdlog::level::level_enum>(
+                std::min(static_cast<int>(spdlog::level::warn), static_cast<int>(base) + demotion));
+        }
+        current_level_.store(effective, std::memory_order_relaxed);
+        if (async_parent_ != nullptr) {
+            // Thread shards gate with current_level_ only: existing_snapshot()
+            // resolves through sink_owner() to the *parent's* spdlog logger,
+            // and lowering its level here would silence every other thread's
+            // shard for the duration of e.g. a muted LogSection.
+            return;
+        }
+        if (auto snapshot = existing_snapshot()) {
+            snapshot->set_level(effective); // spdlog stores its level atomically
+        } // not created yet: first emission applies current_level_
     }
-    void warn(std::string_view msg) { log(spdlog::level::warn, msg); }
 
-    template <typename... Args> void error(fmt::format_string<Args...> fmt_str, Args &&...args) {
-        log(spdlog::level::err, fmt_str, std::forward<Args>(args)...);
+    /// Per-emission accounting for adaptive verbosity. Counter bumps are
+    /// relaxed and uncontended in the common case; once per window one thread
+    /// wins the CAS on the window start and evaluates the budget, so the
+    /// demote/promote decision runs at most once a second regardless of rate.
+    void adaptive_account(std::chrono::steady_clock::time_point render_start) {
+        auto now = std::chrono::steady_clock::now();
+        adaptive_count_.fetch_add(1, std::memory_order_relaxed);
+        adaptive_render_ns_.fetch_add(
+            static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(now - render_start).count()),
+            std::memory_order_relaxed);
+
+        constexpr int64_t window_ns = 1'000'000'000;
+        int64_t now_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(now.time_since_epoch()).count();
+        int64_t window_start = adaptive_window_start_ns_.load(std::memory_order_relaxed);
+        if (now_ns - window_start < window_ns) {
+            return;
+        }
+        if (!adaptive_window_start_ns_.compare_exchange_strong(window_start, now_ns, std::memory_order_relaxed)) {
+            return; // another thread is rotating this window
+        }
+        // Idle loggers rotate late (accounting only runs on emission), so
+        // normalize by the real window length rather than assuming 1s.
+        double seconds = static_cast<double>(now_ns - window_start) / 1e9;
+        double msg_rate = static_cast<double>(adaptive_count_.exchange(0, std::memory_order_relaxed)) / seconds;
+        double us_rate =
+            static_cast<double>(adaptive_render_ns_.exchange(0, std::memory_order_relaxed)) / 1000.0 / seconds;
+        bool over = (adaptive_msg_budget_ != 0 && msg_rate > static_cast<double>(adaptive_msg_budget_)) ||
+                    (adaptive_us_budget_ != 0 && us_rate > static_cast<double>(adaptive_us_budget_));
+        // recovery needs clear headroom (half the budget), not just "under"
+        bool calm = (adaptive_msg_budget_ == 0 || msg_rate < static_cast<double>(adaptive_msg_budget_) * 0.5) &&
+                    (adaptive_us_budget_ == 0 || us_rate < static_cast<double>(adaptive_us_budget_) * 0.5);
+
+        int demotion = adaptive_demotion_.load(std::memory_order_relaxed);
+        auto base = base_level_.load(std::memory_order_relaxed);
+        if (over) {
+            adaptive_quiet_windows_.store(0, std::memory_order_relaxed);
+            if (static_cast<int>(base) + demotion < static_cast<int>(spdlog::level::warn)) {
+                adaptive_demotion_.store(demotion + 1, std::memory_order_relaxed);
+                apply_effective_level();
+                format_and_log(spdlog::level::warn,
+                               fmt::format("adaptive verbosity: raised level to {} ({:.0f} msgs/s, {:.0f} us/s spent "
+                                           "logging)",
+                                           level_to_string[static_cast<size_t>(get_current_level())], msg_rate,
+                                           us_rate));
+            }
+        } else if (demotion > 0 && calm) {
+            if (adaptive_quiet_windows_.fetch_add(1, std::memory_order_relaxed) + 1 >= adaptive_recover_windows_) {
+                adaptive_quiet_windows_.store(0, std::memory_order_relaxed);
+                adaptive_demotion_.store(demotion - 1, std::memory_order_relaxed);
+                apply_effective_level();
+                format_and_log(spdlog::level::warn,
+                               fmt::format("adaptive verbosity: restored level to {}",
+                                           level_to_string[static_cast<size_t>(get_current_level())]));
+            }
+        } else {
+            adaptive_quiet_windows_.store(0, std::memory_order_relaxed);
+        }
     }
-    void error(std::string_view msg) { log(spdlog::level::err, msg); }
 
-    template <typename... Args> void critical(fmt::format_string<Args...> fmt_str, Args &&...args) {
-        log(spdlog::level::critical, fmt_str, std::forward<Args>(args)...);
+    /// The calling thread's capture slot (shared across Logger instances;
+    /// the owner tag disambiguates). Function-local so the header stays
+    /// include-order agnostic, like the thread_local format buffers.
+    static ThreadCapture &thread_capture() {
+        static thread_local ThreadCapture capture;
+        return capture;
     }
-    void critical(std::string_view msg) { log(spdlog::level::critical, msg); }
 
-    // Sections still require formatting, but you could add overloads too if you want.
-    template <typename... Args> void start_section(fmt::format_string<Args...> fmt_str, Args &&...args) {
-        start_section(spdlog::level::info, fmt_str, std::forward<Args>(args)...);
+    /// The calling thread's active capture for THIS logger, or null.
+    SectionBuffer *active_capture() const {
+        const ThreadCapture &capture = thread_capture();
+        return capture.owner == this ? capture.buffer : nullptr;
     }
-    template <typename... Args>
-    void start_section(spdlog::level::level_enum lvl, fmt::format_string<Args...> fmt_str, Args &&...args) {
-        log(lvl, "=== start {} === {{", fmt::format(fmt_str, std::forward<Args>(args)...));
-        ++section_depth_;
+
+    /// Hands a fully formatted record to the sinks, either directly or via the async queue.
+    /// Thread shards route through their parent's queue so one collector merges all threads.
+    void emit(spdlog::level::level_enum lvl, std::string_view full_msg) {
+        if (SectionBuffer *capture = active_capture()) {
+            // buffered section: one arena memcpy now, sinks only on commit
+            capture->arena.append(full_msg);
+            capture->records.emplace_back(lvl, static_cast<uint32_t>(full_msg.size()));
+            return;
+        }
+        count_main_log_bytes(full_msg);
+        Logger *async_owner = async_parent_ != nullptr ? async_parent_ : this;
+        if (!async_owner->async_running_.load(std::memory_order_acquire)) {
+            // no flush decision here: callers evaluate the triggers once per
+            // *message* (render_lines) or per replayed section, so a 50-line
+            // warn dump with on_level=warn flushes once, not 50 times
+            sink_snapshot()->log(lvl, full_msg);
+            return;
+        }
+        // the async queue outlives the call, so it has to own a copy
+        LogRecordRingBuffer::Record record;
+        record.lvl = lvl;
+        record.text = std::string(full_msg);
+        async_owner->push_record(std::move(record));
     }
-    template <typename... Args> void end_section(fmt::format_string<Args...> fmt_str, Args &&...args) {
-        end_section(spdlog::level::info, fmt_str, std::forward<Args>(args)...);
+
+    static int64_t steady_now_ns() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+            .count();
     }
-    template <typename... Args>
-    void end_section(spdlog::level::level_enum lvl, fmt::format_string<Args...> fmt_str, Args &&...args) {
-        if (section_depth_ > 0)
-            --section_depth_;
-        log(lvl, "===   end {} === }}", fmt::format(fmt_str, std::forward<Args>(args)...));
+
+    /// maybe_flush() gated to synchronous delivery: in async mode the worker
+    /// makes the flush decision per drained burst, not the producers.
+    void maybe_flush_sync(spdlog::level::level_enum lvl, size_t message_count) {
+        Logger *async_owner = async_parent_ != nullptr ? async_parent_ : this;
+        if (!async_owner->async_running_.load(std::memory_order_acquire)) {
+            maybe_flush(lvl, message_count);
+        }
+    }
+
+    /// Evaluates the flush triggers after @p message_count messages at @p lvl.
+    void maybe_flush(spdlog::level::level_enum lvl, size_t message_count) {
+        const FlushPolicy &policy = flush_policy_;
+        if (policy.on_level != spdlog::level::off && lvl >= policy.on_level) {
+            flush();
+            return;
+        }
+        if (policy.every_n_messages > 0) {
+            size_t pending = messages_since_flush_.fetch_add(message_count, std::memory_order_relaxed) + message_count;
+            if (pending >= policy.every_n_messages) {
+                flush();
+                return;
+            }
+        }
+        if (policy.every_duration.count() > 0) {
+            int64_t elapsed = steady_now_ns() - last_flush_ns_.load(std::memory_order_relaxed);
+            if (elapsed >= std::chrono::duration_cast<std::chrono::nanoseconds>(policy.every_duration).count()) {
+                flush();
+            }
+        }
+    }
+
+    /// Enqueues a record, applying the configured overflow policy when full.
+    /// The shared_ptr snapshot keeps the ring alive even if disable_async()
+    /// resets the member while we're inside try_push; a producer that loses
+    /// the race entirely (null snapshot) delivers synchronously instead.
+    void push_record(LogRecordRingBuffer::Record &&record) {
+        auto queue = std::atomic_load_explicit(&async_queue_, std::memory_order_acquire);
+        if (queue == nullptr) {
+            consume(record);
+            maybe_flush(record.lvl, 1);
+            return;
+        }
+        const OverflowPolicy policy = overflow_policy_.load(std::memory_order_relaxed);
+        while (!queue->try_push(std::move(record))) {
+            switch (policy) {
+            case OverflowPolicy::block:
+                std::this_thread::yield();
+                break;
+            case OverflowPolicy::drop_oldest:
+                queue->discard_oldest();
+                async_dropped_.fetch_add(1, std::memory_order_relaxed);
+                break;
+            case OverflowPolicy::drop_newest:
+                async_dropped_.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+        }
+    }
+
+    /// Worker-thread loop: pops queued records and performs the sink I/O.
+    /// Flush triggers are evaluated once per drained burst, not per record, so
+    /// bursts (and the lines of multi-line messages) coalesce into one flush.
+    void drain_async_queue() {
+        // the worker outlives every enable_async() ring swap it could see,
+        // but snapshot anyway so it mirrors the producer side
+        auto queue = std::atomic_load_explicit(&async_queue_, std::memory_order_acquire);
+        LogRecordRingBuffer::Record record;
+        while (async_running_.load(std::memory_order_acquire)) {
+            size_t burst = 0;
+            spdlog::level::level_enum max_lvl = spdlog::level::trace;
+            while (queue->try_pop(record)) {
+                consume(record);
+                max_lvl = std::max(max_lvl, record.lvl);
+                ++burst;
+            }
+            if (burst > 0) {
+                maybe_flush(max_lvl, burst);
+            } else {
+                std::this_thread::sleep_for(std::chrono::microseconds(100));
+            }
+        }
+        // flush whatever producers managed to enqueue before shutdown, at
+        // the real drained level so an on_level trigger still fires
+        size_t burst = 0;
+        spdlog::level::level_enum max_lvl = spdlog::level::trace;
+        while (queue->try_pop(record)) {
+            consume(record);
+            max_lvl = std::max(max_lvl, record.lvl);
+            ++burst;
+        }
+        if (burst > 0) {
+            maybe_flush(max_lvl, burst);
+        }
     }
 
-    void disable_all_levels() {
-        current_level_ = spdlog::level::off;
-        logger_->set_level(current_level_);
+    /// Worker-thread side of a single record: run any deferred format, then sink it.
+    void consume(LogRecordRingBuffer::Record &record) {
+        if (record.deferred.valid()) {
+            // worker-thread only, so one reused buffer is enough
+            thread_local fmt::memory_buffer deferred_buffer;
+            deferred_buffer.clear();
+            record.deferred.format(deferred_buffer);
+            record.deferred.reset();
+            render_lines(record.lvl, std::string_view(deferred_buffer.data(), deferred_buffer.size()),
+                         record.section_depth, /*force_sync=*/true);
+        } else {
+            sink_snapshot()->log(record.lvl, record.text);
+        }
     }
 
-    void enable_all_levels() {
-        current_level_ = spdlog::level::trace;
-        logger_->set_level(current_level_);
+    /// Sinks emit the buffer verbatim when the Logger renders timestamps itself.
+    std::string effective_pattern() const {
+        return fast_timestamps_.load(std::memory_order_relaxed) ? std::string("%v") : current_pattern_;
     }
 
-  private:
-    void format_and_log(spdlog::level::level_enum lvl, std::string msg) {
-        // Compute the maximum length of all level names
-        static size_t max_level_len = [] {
-            size_t max_len = 0;
-            for (const auto &p : level_to_string) {
-                if (p.second.size() > max_len) {
-                    max_len = p.second.size();
-                }
+    /// Applies the per-sink pattern override if one was registered, else the
+    /// Logger-wide pattern. Fast timestamps trump both (everything is
+    /// pre-rendered, sinks must not format again). config_mutex_ held.
+    void apply_pattern(const spdlog::sink_ptr &sink) {
+        if (!fast_timestamps_.load(std::memory_order_relaxed)) {
+            auto it = sink_patterns_.find(sink.get());
+            if (it != sink_patterns_.end()) {
+                sink->set_pattern(it->second);
+                return;
             }
-            return max_len;
-        }();
+        }
+        sink->set_pattern(effective_pattern());
+    }
+
+    /// Who owns the published sink set: the async parent for thread shards.
+    const Logger *sink_owner() const { return async_parent_ != nullptr ? async_parent_ : this; }
+
+    /// Lock-free reader side of the RCU scheme: one atomic shared_ptr load
+    /// yields an immutable-for-us logger whose sink vector is never mutated.
+    /// The first emission takes the slow path and actually builds the logger.
+    std::shared_ptr<spdlog::logger> sink_snapshot() const {
+        auto snapshot = std::atomic_load_explicit(&sink_owner()->logger_, std::memory_order_acquire);
+        if (snapshot == nullptr) {
+            // lazily creating the logger is conceptually const (caching)
+            snapshot = const_cast<Logger *>(sink_owner())->ensure_created();
+        }
+        return snapshot;
+    }
 
-        // Precompute the level padding
-        const std::string &level_str = level_to_string.at(lvl);
-        size_t padding = max_level_len - level_str.size();
+    /// Like sink_snapshot() but never triggers creation; null until first use.
+    std::shared_ptr<spdlog::logger> existing_snapshot() const {
+        return std::atomic_load_explicit(&sink_owner()->logger_, std::memory_order_acquire);
+    }
 
-        // Prepend section bars
-        std::string prefix;
-        for (int i = 0; i < section_depth_; ++i) {
-            prefix += "| ";
+    /// Slow path of sink_snapshot(): builds the spdlog logger on first use.
+    std::shared_ptr<spdlog::logger> ensure_created() {
+        std::lock_guard<std::mutex> lock(config_mutex_);
+        auto current = std::atomic_load_explicit(&logger_, std::memory_order_acquire);
+        if (current != nullptr) {
+            return current; // another thread won the race
         }
+        std::vector<spdlog::sink_ptr> sinks;
+        if (use_default_stdout_) {
+            sinks.push_back(std::make_shared<spdlog::sinks::stdout_color_sink_mt>());
+        }
+        return create_and_publish(std::move(sinks));
+    }
 
-        // Now split on newlines
-        std::istringstream iss(msg);
-        std::string line;
-        while (std::getline(iss, line)) {
-            std::string full_msg = std::string(padding, ' ') + prefix + line;
-            logger_->log(lvl, full_msg);
+    /**
+     * @brief Builds, registers and publishes the spdlog logger (config_mutex_ held).
+     *
+     * Name uniquification is an O(1) retry with a process-wide counter
+     * suffix, taken only when registration actually collides — the old
+     * constructor probed the registry linearly for every logger created.
+     */
+    std::shared_ptr<spdlog::logger> create_and_publish(std::vector<spdlog::sink_ptr> sinks) {
+        std::string name = base_name_;
+        std::shared_ptr<spdlog::logger> next;
+        for (;;) {
+            next = std::make_shared<spdlog::logger>(name, sinks.begin(), sinks.end());
+            try {
+                spdlog::register_logger(next);
+                break;
+            } catch (const spdlog::spdlog_ex &) {
+                static std::atomic<unsigned> next_suffix{1};
+                name = base_name_ + "_" + std::to_string(next_suffix.fetch_add(1, std::memory_order_relaxed));
+            }
         }
+        next->set_level(current_level_.load(std::memory_order_relaxed));
+        for (auto &sink : next->sinks()) {
+            apply_pattern(sink);
+        }
+        std::atomic_store_explicit(&logger_, next, std::memory_order_release);
+        return next;
     }
 
-    void reapply_formatting() {
-        logger_->set_level(current_level_);
-        for (auto &sink : logger_->sinks()) {
-            sink->set_pattern(current_pattern_);
+    /**
+     * @brief Writer side: builds a fresh spdlog logger around @p sinks and
+     * publishes it with an atomic store. In-flight readers keep their old
+     * snapshot alive through its shared_ptr; new calls see the new set.
+     * Callers hold config_mutex_ so concurrent writers serialize.
+     */
+    void publish_rebuilt(std::vector<spdlog::sink_ptr> sinks) {
+        auto current = std::atomic_load_explicit(&logger_, std::memory_order_acquire);
+        if (current == nullptr) {
+            // first touch was a sink-config call rather than an emission
+            create_and_publish(std::move(sinks));
+            return;
+        }
+        auto next = std::make_shared<spdlog::logger>(current->name(), sinks.begin(), sinks.end());
+        next->set_level(current_level_.load(std::memory_order_relaxed));
+        for (auto &sink : next->sinks()) {
+            apply_pattern(sink);
         }
+        // Swap the registry entry too: leaving the old logger registered
+        // would hand spdlog::get()/apply_all()/shutdown() a stale object
+        // with the discarded sink set — and pin those sinks for the process
+        // lifetime. The name is already ours, so re-registering can only
+        // collide if someone registered a foreign logger under it meanwhile;
+        // in that case ours just stays unregistered.
+        spdlog::drop(current->name());
+        try {
+            spdlog::register_logger(next);
+        } catch (const spdlog::spdlog_ex &) {
+        }
+        std::atomic_store_explicit(&logger_, std::move(next), std::memory_order_release);
     }
 
     int section_depth_;
+    // published/consumed with std::atomic_load/store (RCU snapshots); the
+    // pointed-to logger's sink vector is immutable after publication
     std::shared_ptr<spdlog::logger> logger_;
-    spdlog::level::level_enum current_level_;
+    std::atomic<spdlog::level::level_enum> current_level_;
     std::string current_pattern_;
+    std::string base_name_;           // registered (possibly suffixed) on first use
+    bool use_default_stdout_ = true;  // cancelled by remove_all_sinks() before first use
+    // when set, render_lines() prepends timestamp + level and sinks use "%v"
+    std::atomic<bool> fast_timestamps_{false};
+
+    // async delivery state; the queue is published/consumed with
+    // std::atomic_load/store so producers racing disable_async() hold the
+    // ring through their snapshot instead of dereferencing a freed buffer
+    std::shared_ptr<LogRecordRingBuffer> async_queue_;
+    std::thread async_worker_;
+    std::atomic<bool> async_running_{false};
+    std::atomic<size_t> async_dropped_{0};
+    std::atomic<OverflowPolicy> overflow_policy_{OverflowPolicy::block}; // read by racing producers
+    bool deferred_formatting_{false};
+
+    // optional binary mmap sink, written in addition to the spdlog sinks
+    std::shared_ptr<BinaryMmapSink> binary_sink_;
+
+    // per-call-site counters for the rate-limited wrappers
+    CallSiteRegistry call_sites_;
+
+    // serializes configuration writers (sink set, pattern); readers never take it
+    std::mutex config_mutex_;
+
+    // per-sink pattern overrides, keyed by sink identity (guarded by config_mutex_)
+    std::map<const spdlog::sinks::sink *, std::string> sink_patterns_;
+
+    // flush batching state
+    FlushPolicy flush_policy_;
+    std::atomic<size_t> messages_since_flush_{0};
+    std::atomic<int64_t> last_flush_ns_{0};
+
+    /// Async-signal-safe crash handler: dump the ring, then the re-raised
+    /// signal hits the restored default disposition.
+    static void crash_signal_handler(int signo) {
+        static constexpr char banner[] = "\n=== logger emergency ring dump ===\n";
+        int fd = crash_dump_fd_.load(std::memory_order_relaxed);
+        (void)!::write(fd, banner, sizeof(banner) - 1);
+        EmergencyRing *ring = crash_ring_.load(std::memory_order_acquire);
+        if (ring != nullptr) {
+            ring->dump(fd);
+        }
+        ::raise(signo);
+    }
+
+    // crash-handler state: static because signal handlers get no context
+    inline static std::atomic<EmergencyRing *> crash_ring_{nullptr};
+    inline static std::atomic<int> crash_dump_fd_{STDERR_FILENO};
+
+    // flight recorder for the last N records (see enable_emergency_ring)
+    std::unique_ptr<EmergencyRing> emergency_ring_;
+
+    // intern table for repeated static text (see enable_interning)
+    std::unique_ptr<StringInternTable> intern_table_;
+
+    // sidecar section index (see enable_section_index)
+    std::unique_ptr<SectionIndexWriter> section_index_;
+    std::atomic<uint64_t> main_log_bytes_{0}; // rendered bytes handed to the sinks
+
+    // adaptive verbosity (enable_adaptive_verbosity). base_level_ is what the
+    // user asked for; current_level_ is base plus the current demotion, so
+    // the should_log gate never learns adaptive mode exists. Counters are
+    // only touched by messages that emit — gated-out calls stay one compare.
+    std::atomic<bool> adaptive_enabled_{false};
+    std::atomic<spdlog::level::level_enum> base_level_{spdlog::level::debug};
+    uint64_t adaptive_msg_budget_ = 0;
+    uint64_t adaptive_us_budget_ = 0;
+    int adaptive_recover_windows_ = 3;
+    std::atomic<uint64_t> adaptive_count_{0};
+    std::atomic<uint64_t> adaptive_render_ns_{0};
+    std::atomic<int64_t> adaptive_window_start_ns_{0};
+    std::atomic<int> adaptive_demotion_{0};
+    std::atomic<int> adaptive_quiet_windows_{0};
+
+    // source-location annotation (off by default to keep output stable)
+    bool source_location_enabled_ = false;
+
+    // per-call-site cost accounting (off by default; see enable_stats)
+    bool stats_enabled_ = false;
+
+    // thread-shard state: set only on loggers returned by for_current_thread()
+    Logger *async_parent_ = nullptr;
+    std::string thread_tag_;
 };
 
 /**
@@ -233,7 +2913,8 @@ class LogSection {
     enum class LogMode {
         inherit, ///< inherit the logging behavior from the parent section
         enable,  ///< enable logging even if parent is muted
-        disable  ///< disable logging for this section
+        disable, ///< disable logging for this section
+        buffered ///< capture into a section-local arena; discard unless committed (see commit())
     };
 
     LogMode mode;
@@ -251,9 +2932,13 @@ class LogSection {
      *
      * @note we can't use variadic args because we want a default argument for disable logging at the end.
      */
-    LogSection(Logger &logger, const std::string &section_name, LogMode mode = LogMode::inherit)
-        : logger_(logger), section_name_(section_name), mode(mode), previous_level_(logger.get_current_level()) {
+    LogSection(Logger &logger, std::string_view section_name, LogMode mode = LogMode::inherit, bool timed = false)
+        : logger_(logger), mode(mode), previous_level_(logger.get_base_level()), timed_(timed) {
 
+        set_name(section_name);
+        if (timed_) {
+            start_time_ = std::chrono::steady_clock::now();
+        }
         switch (mode) {
         case LogMode::disable:
             // by disabling all levels it makes it so that nested logging is disabled.
@@ -261,15 +2946,39 @@ class LogSection {
             break;
         case LogMode::enable:
             logger_.enable_all_levels();
-            logger_.start_section("{}", section_name_);
+            logger_.start_section_direct(spdlog::level::info, name());
             break;
         case LogMode::inherit:
             // when logging is enabled this does something, otherwise it does not
-            logger_.start_section("{}", section_name_);
+            logger_.start_section_direct(spdlog::level::info, name());
+            break;
+        case LogMode::buffered:
+            // everything from here on (including the start line) lands in the
+            // arena; normal destruction throws it away without sink I/O
+            buffer_ = std::make_unique<Logger::SectionBuffer>();
+            previous_buffer_ = logger_.begin_buffered_section(*buffer_);
+            uncaught_on_entry_ = std::uncaught_exceptions();
+            logger_.start_section_direct(spdlog::level::info, name());
             break;
         }
     }
 
+    /**
+     * @brief Threshold-timer mode: only makes noise when the scope was slow.
+     *
+     * Records a steady_clock timestamp at construction and emits a single
+     * summary line at destruction *only if* the scope took longer than
+     * @p emit_threshold — no start line, no end line, no section depth change,
+     * so instrumentation left on in production costs one clock read per scope
+     * when the code is fast.
+     */
+    LogSection(Logger &logger, std::string_view section_name, std::chrono::nanoseconds emit_threshold)
+        : logger_(logger), mode(LogMode::inherit), previous_level_(logger.get_base_level()), timed_(true),
+          threshold_mode_(true), emit_threshold_(emit_threshold) {
+        set_name(section_name);
+        start_time_ = std::chrono::steady_clock::now();
+    }
+
     /**
      * @brief Destructor that automatically ends the log section.
      *
@@ -277,17 +2986,50 @@ class LogSection {
      * is restored before ending the section.
      */
     ~LogSection() {
+        double elapsed_ms = 0;
+        if (timed_) {
+            elapsed_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start_time_)
+                             .count();
+        }
+
+        if (threshold_mode_) {
+            if (elapsed_ms >= std::chrono::duration<double, std::milli>(emit_threshold_).count()) {
+                logger_.warn("=== section {} took {:.3f}ms (over {:.3f}ms threshold) ===", name(), elapsed_ms,
+                             std::chrono::duration<double, std::milli>(emit_threshold_).count());
+            }
+            return;
+        }
 
         switch (mode) {
         case LogMode::disable:
             logger_.set_level(previous_level_);
             break;
         case LogMode::enable:
-            logger_.end_section("{}", section_name_);
+            if (timed_) {
+                logger_.end_section_with_elapsed(spdlog::level::info, name(), elapsed_ms);
+            } else {
+                logger_.end_section_direct(spdlog::level::info, name());
+            }
             logger_.set_level(previous_level_);
             break;
         case LogMode::inherit:
-            logger_.end_section("{}", section_name_);
+            if (timed_) {
+                logger_.end_section_with_elapsed(spdlog::level::info, name(), elapsed_ms);
+            } else {
+                logger_.end_section_direct(spdlog::level::info, name());
+            }
+            break;
+        case LogMode::buffered:
+            // the end line is captured too, so a replayed section is complete
+            if (timed_) {
+                logger_.end_section_with_elapsed(spdlog::level::info, name(), elapsed_ms);
+            } else {
+                logger_.end_section_direct(spdlog::level::info, name());
+            }
+            logger_.end_buffered_section(previous_buffer_);
+            if (committed_ || std::uncaught_exceptions() > uncaught_on_entry_) {
+                logger_.flush_buffered_section(*buffer_);
+            }
             break;
         }
     }
@@ -298,14 +3040,62 @@ class LogSection {
     /// Deleted copy assignment operator to prevent accidental assignments.
     LogSection &operator=(const LogSection &) = delete;
 
+    /**
+     * @brief Marks a buffered section's capture for replay at destruction.
+     *
+     * The common success path never calls this, so the verbose interior of
+     * the section costs arena writes that are simply thrown away. Call it on
+     * failure paths that don't throw; an exception unwinding through the
+     * section flushes automatically. No effect in other modes.
+     */
+    void commit() { committed_ = true; }
+
+    /// The section name; views into the inline buffer or the heap fallback.
+    std::string_view name() const {
+        return heap_name_.empty() ? std::string_view(inline_name_, inline_name_len_) : std::string_view(heap_name_);
+    }
+
   private:
+    /// Names up to inline_name_capacity bytes (the overwhelmingly common
+    /// case) are memcpy'd into the inline buffer; longer ones fall back to a
+    /// heap string. Either way the constructor never formats the name.
+    void set_name(std::string_view section_name) {
+        if (section_name.size() <= inline_name_capacity) {
+            std::memcpy(inline_name_, section_name.data(), section_name.size());
+            inline_name_len_ = static_cast<uint8_t>(section_name.size());
+        } else {
+            heap_name_ = std::string(section_name);
+        }
+    }
+
+    static constexpr size_t inline_name_capacity = 64;
+
     Logger &logger_;                           ///< Reference to the logger that handles this section.
-    std::string section_name_;                 ///< The section name used in log output.
+    char inline_name_[inline_name_capacity];   ///< In-place storage for short section names.
+    uint8_t inline_name_len_ = 0;              ///< Bytes used in inline_name_.
+    std::string heap_name_;                    ///< Fallback for names longer than the inline buffer.
     spdlog::level::level_enum previous_level_; ///< The log level to restore after destruction.
+
+    // buffered-mode state
+    std::unique_ptr<Logger::SectionBuffer> buffer_;      ///< arena; allocated only in buffered mode
+    Logger::ThreadCapture previous_buffer_;              ///< enclosing capture to restore (nesting)
+    bool committed_ = false;                             ///< replay instead of discard at destruction
+    int uncaught_on_entry_ = 0;                          ///< uncaught-exception count at construction
+
+    // scoped-timer state
+    bool timed_ = false;                          ///< append elapsed time to the end_section line
+    bool threshold_mode_ = false;                 ///< only emit at all when slower than emit_threshold_
+    std::chrono::nanoseconds emit_threshold_{0};  ///< threshold for threshold_mode_
+    std::chrono::steady_clock::time_point start_time_; ///< set in the constructor when timing
 };
 
 extern LazyConstruction<Logger, std::string> global_logger;
 
+inline Logger &Logger::for_current_thread() {
+    thread_local Logger shard(ThreadShard{}, *global_logger);
+    return shard;
+}
+
 class GlobalLogSection {
   public:
     /**
@@ -318,7 +3108,7 @@ class GlobalLogSection {
      * @param logging_enabled Whether logging is enabled for this section.
      */
 
-    GlobalLogSection(const std::string &section_name, LogSection::LogMode mode = LogSection::LogMode::inherit)
+    GlobalLogSection(std::string_view section_name, LogSection::LogMode mode = LogSection::LogMode::inherit)
         : inner_section(*global_logger, section_name, mode) {}
 
   private:
@@ -0,0 +1,263 @@
+// Micro-benchmarks for the logging hot path. Built with Google Benchmark;
+// numbers here are what we compare across releases, so keep benchmark names
+// stable. All benchmarks log into a null or /dev/null-backed sink unless the
+// point of the benchmark is a specific sink type.
+
+#include "logger.hpp"
+
+#include <benchmark/benchmark.h>
+
+#include <spdlog/sinks/null_sink.h>
+
+namespace {
+
+// A logger whose only sink swallows everything, so we measure our own
+// pipeline (format, padding, prefix, split) rather than sink I/O.
+Logger &null_sink_logger() {
+    static Logger logger("bench_null");
+    static bool initialized = [] {
+        logger.remove_all_sinks();
+        logger.add_sink(std::make_shared<spdlog::sinks::null_sink_mt>());
+        return true;
+    }();
+    (void)initialized;
+    return logger;
+}
+
+} // namespace
+
+// ====== Message shapes ======
+
+static void BM_single_line(benchmark::State &state) {
+    Logger &logger = null_sink_logger();
+    for (auto _ : state) {
+        logger.info("frame {} took {}ms", 1234, 16.6);
+    }
+}
+BENCHMARK(BM_single_line);
+
+static void BM_multi_line(benchmark::State &state) {
+    Logger &logger = null_sink_logger();
+    std::string msg;
+    for (int i = 0; i < state.range(0); ++i) {
+        msg += "entity state line with some payload\n";
+    }
+    for (auto _ : state) {
+        logger.info("{}", msg);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_multi_line)->Arg(2)->Arg(10)->Arg(100);
+
+static void BM_runtime_string(benchmark::State &state) {
+    Logger &logger = null_sink_logger();
+    for (auto _ : state) {
+        logger.info("a plain message with no formatting");
+    }
+}
+BENCHMARK(BM_runtime_string);
+
+// ====== Convenience wrappers ======
+
+static void BM_wrapper_trace(benchmark::State &state) {
+    Logger &logger = null_sink_logger();
+    logger.enable_all_levels();
+    for (auto _ : state) {
+        logger.trace("value {}", 42);
+    }
+}
+BENCHMARK(BM_wrapper_trace);
+
+static void BM_wrapper_debug(benchmark::State &state) {
+    Logger &logger = null_sink_logger();
+    logger.enable_all_levels();
+    for (auto _ : state) {
+        logger.debug("value {}", 42);
+    }
+}
+BENCHMARK(BM_wrapper_debug);
+
+static void BM_wrapper_info(benchmark::State &state) {
+    Logger &logger = null_sink_logger();
+    for (auto _ : state) {
+        logger.info("value {}", 42);
+    }
+}
+BENCHMARK(BM_wrapper_info);
+
+static void BM_wrapper_warn(benchmark::State &state) {
+    Logger &logger = null_sink_logger();
+    for (auto _ : state) {
+        logger.warn("value {}", 42);
+    }
+}
+BENCHMARK(BM_wrapper_warn);
+
+static void BM_wrapper_error(benchmark::State &state) {
+    Logger &logger = null_sink_logger();
+    for (auto _ : state) {
+        logger.error("value {}", 42);
+    }
+}
+BENCHMARK(BM_wrapper_error);
+
+static void BM_wrapper_critical(benchmark::State &state) {
+    Logger &logger = null_sink_logger();
+    for (auto _ : state) {
+        logger.critical("value {}", 42);
+    }
+}
+BENCHMARK(BM_wrapper_critical);
+
+// Construction is a lazy shell: the spdlog logger and sinks only exist once
+// something is emitted, so per-subsystem loggers are nearly free to create.
+static void BM_logger_construction(benchmark::State &state) {
+    for (auto _ : state) {
+        Logger logger("bench_ctor");
+        benchmark::DoNotOptimize(logger);
+    }
+}
+BENCHMARK(BM_logger_construction);
+
+// ====== Sections ======
+
+static void BM_log_section_construction(benchmark::State &state) {
+    Logger &logger = null_sink_logger();
+    for (auto _ : state) {
+        LogSection section(logger, "bench section");
+    }
+}
+BENCHMARK(BM_log_section_construction);
+
+static void BM_log_inside_nested_sections(benchmark::State &state) {
+    Logger &logger = null_sink_logger();
+    std::vector<std::unique_ptr<LogSection>> sections;
+    for (int i = 0; i < state.range(0); ++i) {
+        sections.push_back(std::make_unique<LogSection>(logger, "depth"));
+    }
+    for (auto _ : state) {
+        logger.info("message at depth {}", state.range(0));
+    }
+    while (!sections.empty()) {
+        sections.pop_back();
+    }
+}
+BENCHMARK(BM_log_inside_nested_sections)->DenseRange(0, 8, 2);
+
+// ====== Filtered-out calls ======
+
+static void BM_disabled_level(benchmark::State &state) {
+    Logger &logger = null_sink_logger();
+    logger.set_level(spdlog::level::warn);
+    for (auto _ : state) {
+        logger.debug("this should be as close to free as possible {}", 42);
+    }
+    logger.set_level(spdlog::level::debug);
+}
+BENCHMARK(BM_disabled_level);
+
+static void BM_muted_section(benchmark::State &state) {
+    Logger &logger = null_sink_logger();
+    LogSection muted(logger, "muted", LogSection::LogMode::disable);
+    for (auto _ : state) {
+        logger.info("invisible {}", 42);
+    }
+}
+BENCHMARK(BM_muted_section);
+
+// ====== Sink types ======
+
+static void BM_sink_file(benchmark::State &state) {
+    Logger logger("bench_file");
+    logger.remove_all_sinks();
+    logger.add_file_sink("/dev/null");
+    for (auto _ : state) {
+        logger.info("file sink message {}", 42);
+    }
+}
+BENCHMARK(BM_sink_file);
+
+static void BM_sink_rotating_file(benchmark::State &state) {
+    Logger logger("bench_rotating");
+    logger.remove_all_sinks();
+    logger.add_rotating_file_sink("/tmp/logger_bench_rotating.log", 1 << 20, 2);
+    for (auto _ : state) {
+        logger.info("rotating sink message {}", 42);
+    }
+}
+BENCHMARK(BM_sink_rotating_file);
+
+static void BM_sink_binary_mmap(benchmark::State &state) {
+    Logger logger("bench_binary");
+    logger.remove_all_sinks();
+    logger.add_sink(std::make_shared<spdlog::sinks::null_sink_mt>());
+    logger.add_binary_mmap_sink("/tmp/logger_bench_binary.blog", 256 << 20);
+    for (auto _ : state) {
+        logger.info("binary sink message {}", 42);
+    }
+}
+BENCHMARK(BM_sink_binary_mmap);
+
+// With two sinks attached spdlog renders the "[%H:%M:%S.%f]" timestamp twice
+// per message; the fast path renders it once into the shared line buffer.
+static void BM_two_sinks_pattern_timestamps(benchmark::State &state) {
+    Logger logger("bench_ts_pattern");
+    logger.remove_all_sinks();
+    logger.add_file_sink("/dev/null");
+    logger.add_file_sink("/dev/null", false);
+    for (auto _ : state) {
+        logger.info("timestamped message {}", 42);
+    }
+}
+BENCHMARK(BM_two_sinks_pattern_timestamps);
+
+static void BM_two_sinks_fast_timestamps(benchmark::State &state) {
+    Logger logger("bench_ts_fast");
+    logger.remove_all_sinks();
+    logger.add_file_sink("/dev/null");
+    logger.add_file_sink("/dev/null", false);
+    logger.enable_fast_timestamps();
+    for (auto _ : state) {
+        logger.info("timestamped message {}", 42);
+    }
+}
+BENCHMARK(BM_two_sinks_fast_timestamps);
+
+// ====== Async / deferred producer side ======
+
+static void BM_async_producer(benchmark::State &state) {
+    Logger logger("bench_async");
+    logger.remove_all_sinks();
+    logger.add_sink(std::make_shared<spdlog::sinks::null_sink_mt>());
+    logger.enable_async(1 << 16, Logger::OverflowPolicy::drop_oldest);
+    for (auto _ : state) {
+        logger.info("async producer message {}", 42);
+    }
+    logger.disable_async();
+}
+BENCHMARK(BM_async_producer);
+
+static void BM_deferred_producer(benchmark::State &state) {
+    Logger logger("bench_deferred");
+    logger.remove_all_sinks();
+    logger.add_sink(std::make_shared<spdlog::sinks::null_sink_mt>());
+    logger.enable_async(1 << 16, Logger::OverflowPolicy::drop_oldest);
+    logger.enable_deferred_formatting();
+    for (auto _ : state) {
+        logger.info("deferred producer message {} {}", 42, 3.14);
+    }
+    logger.disable_async();
+}
+BENCHMARK(BM_deferred_producer);
+
+// ====== Rate limiting ======
+
+static void BM_rate_limited_suppressed(benchmark::State &state) {
+    Logger &logger = null_sink_logger();
+    for (auto _ : state) {
+        logger.log_every_n(1000000, spdlog::level::info, "mostly suppressed {}", 42);
+    }
+}
+BENCHMARK(BM_rate_limited_suppressed);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,413 @@
+// Regression-guarded performance test for the logging hot path.
+//
+// Micro-benchmarks (logger_benchmarks.cpp) answer "how fast is X"; this
+// target answers "did a change make production logging slower" — it replays
+// a recorded production-like workload (mixed levels, nested LogSections,
+// multi-line dumps, several threads) against a Logger, records HDR-style
+// latency histograms per call-site class, and exits non-zero when p99
+// exceeds the checked-in baseline by more than the allowed margin, so a CI
+// step running this binary fails the build on regression.
+//
+//     logger_perf_test [--trace FILE] [--baseline FILE]
+//                      [--margin PCT] [--update-baseline] [--write-trace]
+//
+// Defaults: logger_perf_workload.trace / logger_perf_baseline.txt next to
+// the binary's working directory, 50% margin (generous because CI machines
+// vary; the baseline should be regenerated per fleet with
+// --update-baseline on a quiet machine).
+//
+// Trace format (text, one op per line, '#' comments) — deployments can
+// contribute traces by emitting the same format from their own
+// instrumentation or through TraceRecorder below:
+//
+//     <thread> log <level> <lines> <bytes>   emit a message
+//     <thread> begin <name>                  open a LogSection
+//     <thread> end <name>                    close the most recent section
+//
+// --write-trace regenerates the default synthetic workload file.
+
+#include "logger.hpp"
+
+#include <bit>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+
+namespace {
+
+// ====== HDR-style latency histogram ======
+
+/**
+ * @brief Log-linear histogram with ~3% relative error, like HDRHistogram.
+ *
+ * 32 linear sub-buckets per power of two of nanoseconds; recording is an
+ * index computation plus an increment, so per-thread histograms can sit on
+ * the measured path. Merge per-thread instances before reading percentiles.
+ */
+class LatencyHistogram {
+  public:
+    void record(uint64_t ns) {
+        counts_[index_for(ns)] += 1;
+        ++total_;
+    }
+
+    void merge(const LatencyHistogram &other) {
+        for (size_t i = 0; i < counts_.size(); ++i) {
+            counts_[i] += other.counts_[i];
+        }
+        total_ += other.total_;
+    }
+
+    uint64_t percentile(double p) const {
+        if (total_ == 0) {
+            return 0;
+        }
+        uint64_t rank = static_cast<uint64_t>(p * static_cast<double>(total_));
+        uint64_t seen = 0;
+        for (size_t i = 0; i < counts_.size(); ++i) {
+            seen += counts_[i];
+            if (seen > rank) {
+                return value_for(i);
+            }
+        }
+        return value_for(counts_.size() - 1);
+    }
+
+    uint64_t count() const { return total_; }
+
+  private:
+    static constexpr int sub_bits = 5; // 32 sub-buckets per power of two
+    static constexpr size_t sub_buckets = 1 << sub_bits;
+    static constexpr size_t bucket_count = (64 - sub_bits + 1) * sub_buckets;
+
+    static size_t index_for(uint64_t ns) {
+        if (ns < sub_buckets) {
+            return static_cast<size_t>(ns);
+        }
+        int shift = std::bit_width(ns) - 1 - sub_bits;
+        return (static_cast<size_t>(shift + 1) << sub_bits) | ((ns >> shift) & (sub_buckets - 1));
+    }
+
+    static uint64_t value_for(size_t index) {
+        size_t shift = index >> sub_bits;
+        uint64_t low = index & (sub_buckets - 1);
+        if (shift == 0) {
+            return low;
+        }
+        return (sub_buckets | low) << (shift - 1);
+    }
+
+    std::array<uint64_t, bucket_count> counts_{};
+    uint64_t total_ = 0;
+};
+
+// ====== Workload traces ======
+
+struct TraceOp {
+    enum Kind { log_line, section_begin, section_end } kind;
+    spdlog::level::level_enum level = spdlog::level::info;
+    int lines = 1;
+    int bytes = 64;
+    std::string name; // section name for begin/end
+};
+
+/// Writes ops in the trace format; embed one of these (or emit the format
+/// directly) in a deployment to record real workloads for contribution.
+class TraceRecorder {
+  public:
+    explicit TraceRecorder(const std::string &path) : out_(path) {
+        out_ << "# logger perf workload trace v1\n";
+        out_ << "# <thread> log <level> <lines> <bytes> | <thread> begin <name> | <thread> end <name>\n";
+    }
+
+    bool ok() const { return static_cast<bool>(out_); }
+
+    void log_line(int thread, spdlog::level::level_enum lvl, int lines, int bytes) {
+        out_ << thread << " log " << level_to_string[static_cast<size_t>(lvl)] << " " << lines << " " << bytes
+             << "\n";
+    }
+    void begin(int thread, std::string_view name) { out_ << thread << " begin " << name << "\n"; }
+    void end(int thread, std::string_view name) { out_ << thread << " end " << name << "\n"; }
+
+  private:
+    std::ofstream out_;
+};
+
+spdlog::level::level_enum parse_level(const std::string &name) {
+    for (size_t i = 0; i < level_to_string.size(); ++i) {
+        if (level_to_string[i] == name) {
+            return static_cast<spdlog::level::level_enum>(i);
+        }
+    }
+    return spdlog::level::info;
+}
+
+/// Loads a trace into per-thread op lists.
+bool load_trace(const std::string &path, std::vector<std::vector<TraceOp>> &per_thread) {
+    std::ifstream in(path);
+    if (!in) {
+        return false;
+    }
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        std::istringstream fields(line);
+        int thread = 0;
+        std::string op;
+        fields >> thread >> op;
+        if (!fields || thread < 0 || thread >= 64) {
+            continue;
+        }
+        if (static_cast<size_t>(thread) >= per_thread.size()) {
+            per_thread.resize(thread + 1);
+        }
+        TraceOp trace_op{};
+        if (op == "log") {
+            std::string level_name;
+            fields >> level_name >> trace_op.lines >> trace_op.bytes;
+            trace_op.kind = TraceOp::log_line;
+            trace_op.level = parse_level(level_name);
+        } else if (op == "begin") {
+            trace_op.kind = TraceOp::section_begin;
+            fields >> trace_op.name;
+        } else if (op == "end") {
+            trace_op.kind = TraceOp::section_end;
+            fields >> trace_op.name;
+        } else {
+            continue;
+        }
+        per_thread[thread].push_back(std::move(trace_op));
+    }
+    return true;
+}
+
+/// The default production-like mix: 8 threads, ~80% single-line info/debug,
+/// nested sections to depth 4, occasional multi-line warn dumps and errors.
+void write_default_trace(const std::string &path) {
+    TraceRecorder recorder(path);
+    std::mt19937 rng(42); // deterministic so the checked-in trace is stable
+    std::uniform_int_distribution<int> percent(0, 99);
+    std::uniform_int_distribution<int> payload(32, 160);
+    std::uniform_int_distribution<int> dump_lines(4, 16);
+    for (int thread = 0; thread < 8; ++thread) {
+        int depth = 0;
+        std::array<const char *, 4> names = {"frame_update", "physics", "pathfinding", "render_prep"};
+        for (int i = 0; i < 3000; ++i) {
+            int roll = percent(rng);
+            if (roll < 55) {
+                recorder.log_line(thread, spdlog::level::info, 1, payload(rng));
+            } else if (roll < 80) {
+                recorder.log_line(thread, spdlog::level::debug, 1, payload(rng));
+            } else if (roll < 85) {
+                recorder.log_line(thread, spdlog::level::warn, dump_lines(rng), payload(rng) * 4);
+            } else if (roll < 87) {
+                recorder.log_line(thread, spdlog::level::err, 1, payload(rng));
+            } else if (roll < 94 && depth < 4) {
+                recorder.begin(thread, names[depth]);
+                ++depth;
+            } else if (depth > 0) {
+                --depth;
+                recorder.end(thread, names[depth]);
+            } else {
+                recorder.log_line(thread, spdlog::level::info, 1, payload(rng));
+            }
+        }
+        while (depth > 0) {
+            --depth;
+            recorder.end(thread, names[depth]);
+        }
+    }
+}
+
+// ====== Replay ======
+
+struct ReplayResult {
+    LatencyHistogram log_single;
+    LatencyHistogram log_multi;
+    LatencyHistogram section;
+};
+
+/// Replays one thread's ops, timing each call site.
+void replay_thread(Logger &logger, const std::vector<TraceOp> &ops, ReplayResult &result) {
+    // payloads are synthesized up front so the timed region is only the call
+    std::string single_payload(200, 'x');
+    std::string multi_payload;
+    for (int i = 0; i < 16; ++i) {
+        multi_payload.append(200, 'x');
+        multi_payload.push_back('\n');
+    }
+    std::vector<std::unique_ptr<LogSection>> sections;
+    for (const TraceOp &op : ops) {
+        auto start = std::chrono::steady_clock::now();
+        switch (op.kind) {
+        case TraceOp::log_line: {
+            if (op.lines <= 1) {
+                logger.log(op.level, std::string_view(single_payload.data(), static_cast<size_t>(op.bytes)));
+            } else {
+                size_t len = std::min(multi_payload.size(), static_cast<size_t>(op.lines) * 201);
+                logger.log(op.level, std::string_view(multi_payload.data(), len));
+            }
+            break;
+        }
+        case TraceOp::section_begin:
+            sections.push_back(std::make_unique<LogSection>(logger, op.name));
+            break;
+        case TraceOp::section_end:
+            if (!sections.empty()) {
+                sections.pop_back();
+            }
+            break;
+        }
+        auto elapsed =
+            std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+        uint64_t ns = static_cast<uint64_t>(elapsed.count());
+        if (op.kind == TraceOp::log_line) {
+            (op.lines <= 1 ? result.log_single : result.log_multi).record(ns);
+        } else {
+            result.section.record(ns);
+        }
+    }
+}
+
+// ====== Baseline file ======
+
+bool load_baseline(const std::string &path, std::map<std::string, uint64_t> &baseline) {
+    std::ifstream in(path);
+    if (!in) {
+        return false;
+    }
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        std::istringstream fields(line);
+        std::string metric;
+        uint64_t ns = 0;
+        if (fields >> metric >> ns) {
+            baseline[metric] = ns;
+        }
+    }
+    return true;
+}
+
+void report(const std::string &name, const LatencyHistogram &histogram, std::map<std::string, uint64_t> &measured) {
+    uint64_t p50 = histogram.percentile(0.50);
+    uint64_t p99 = histogram.percentile(0.99);
+    uint64_t p999 = histogram.percentile(0.999);
+    std::cout << name << ": n=" << histogram.count() << " p50=" << p50 << "ns p99=" << p99 << "ns p999=" << p999
+              << "ns\n";
+    measured[name + "_p99"] = p99;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    std::string trace_path = "logger_perf_workload.trace";
+    std::string baseline_path = "logger_perf_baseline.txt";
+    double margin = 0.50;
+    bool update_baseline = false;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--trace" && i + 1 < argc) {
+            trace_path = argv[++i];
+        } else if (arg == "--baseline" && i + 1 < argc) {
+            baseline_path = argv[++i];
+        } else if (arg == "--margin" && i + 1 < argc) {
+            margin = std::stod(argv[++i]) / 100.0;
+        } else if (arg == "--update-baseline") {
+            update_baseline = true;
+        } else if (arg == "--write-trace") {
+            write_default_trace(trace_path);
+            std::cout << "wrote " << trace_path << "\n";
+            return 0;
+        } else {
+            std::cerr << "usage: logger_perf_test [--trace FILE] [--baseline FILE] [--margin PCT]"
+                         " [--update-baseline] [--write-trace]\n";
+            return 1;
+        }
+    }
+
+    std::vector<std::vector<TraceOp>> per_thread;
+    if (!load_trace(trace_path, per_thread) || per_thread.empty()) {
+        std::cerr << "logger_perf_test: cannot load trace " << trace_path << " (--write-trace regenerates it)\n";
+        return 1;
+    }
+
+    // production-like setup: shared sinks, fast timestamps, and one thread
+    // shard per replay thread. Shards are the supported way to drive one
+    // sink set from many threads — LogSection depth lives per Logger, so
+    // opening sections on a single shared instance from several threads
+    // would race on it and measure undefined behavior.
+    global_logger->remove_all_sinks();
+    global_logger->add_file_sink("/dev/null");
+    global_logger->enable_fast_timestamps();
+
+    // one warm-up pass so lazy init and page faults don't land in the histograms
+    {
+        ReplayResult warmup;
+        replay_thread(Logger::for_current_thread(), per_thread[0], warmup);
+    }
+
+    std::vector<ReplayResult> results(per_thread.size());
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < per_thread.size(); ++t) {
+        threads.emplace_back([&ops = per_thread[t], &result = results[t]] {
+            replay_thread(Logger::for_current_thread(), ops, result);
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+
+    ReplayResult merged;
+    for (const ReplayResult &result : results) {
+        merged.log_single.merge(result.log_single);
+        merged.log_multi.merge(result.log_multi);
+        merged.section.merge(result.section);
+    }
+
+    std::map<std::string, uint64_t> measured;
+    report("log_single", merged.log_single, measured);
+    report("log_multi", merged.log_multi, measured);
+    report("section", merged.section, measured);
+
+    if (update_baseline) {
+        std::ofstream out(baseline_path);
+        out << "# p99 latency baselines in ns, regenerate with logger_perf_test --update-baseline\n";
+        for (const auto &[metric, ns] : measured) {
+            out << metric << " " << ns << "\n";
+        }
+        std::cout << "wrote " << baseline_path << "\n";
+        return 0;
+    }
+
+    std::map<std::string, uint64_t> baseline;
+    if (!load_baseline(baseline_path, baseline)) {
+        std::cerr << "logger_perf_test: no baseline at " << baseline_path
+                  << " (--update-baseline creates one); not enforcing\n";
+        return 0;
+    }
+
+    int failures = 0;
+    for (const auto &[metric, baseline_ns] : baseline) {
+        auto it = measured.find(metric);
+        if (it == measured.end()) {
+            continue;
+        }
+        uint64_t budget = static_cast<uint64_t>(static_cast<double>(baseline_ns) * (1.0 + margin));
+        if (it->second > budget) {
+            std::cerr << "REGRESSION: " << metric << " measured " << it->second << "ns > budget " << budget
+                      << "ns (baseline " << baseline_ns << "ns + " << static_cast<int>(margin * 100) << "%)\n";
+            ++failures;
+        }
+    }
+    if (failures == 0) {
+        std::cout << "all p99 latencies within budget\n";
+    }
+    return failures == 0 ? 0 : 1;
+}
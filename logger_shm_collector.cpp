@@ -0,0 +1,134 @@
+// Collector process for ShmLogSink segments: opens every shared-memory
+// segment of a region, merges records across processes by timestamp and
+// writes one output stream. Run one collector per host:
+//
+//     logger_shm_collector <region_name> [output_file]
+//
+// Worker processes attach with Logger::add_shm_sink("<region_name>") and
+// never block on this process; segments whose producer has exited are
+// drained and unlinked. Stop with SIGINT/SIGTERM.
+
+#include "logger.hpp"
+
+#include <dirent.h>
+
+#include <csignal>
+#include <iostream>
+#include <map>
+#include <memory>
+
+namespace {
+
+std::atomic<bool> running{true};
+
+void handle_stop(int) { running.store(false, std::memory_order_relaxed); }
+
+/// Opens readers for segments of @p region that aren't tracked yet.
+/// Segment names look like "<region>.<pid>.<n>" under /dev/shm.
+void scan_for_segments(const std::string &region, std::map<std::string, std::unique_ptr<ShmLogSink::Reader>> &readers) {
+    DIR *shm_dir = ::opendir("/dev/shm");
+    if (shm_dir == nullptr) {
+        return;
+    }
+    const std::string prefix = region + ".";
+    while (dirent *entry = ::readdir(shm_dir)) {
+        std::string_view file_name(entry->d_name);
+        if (file_name.substr(0, prefix.size()) != prefix) {
+            continue;
+        }
+        std::string shm_name = "/" + std::string(file_name);
+        if (readers.count(shm_name) != 0) {
+            continue;
+        }
+        try {
+            readers.emplace(shm_name, std::make_unique<ShmLogSink::Reader>(shm_name));
+            std::cerr << "logger_shm_collector: attached " << shm_name << "\n";
+        } catch (const spdlog::spdlog_ex &) {
+            // producer is still initializing the segment; retry on the next scan
+        }
+    }
+    ::closedir(shm_dir);
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    if (argc < 2 || argc > 3) {
+        std::cerr << "usage: logger_shm_collector <region_name> [output_file]\n";
+        return 1;
+    }
+    const std::string region = argv[1];
+
+    std::ofstream output_file;
+    if (argc == 3) {
+        output_file.open(argv[2], std::ios::app);
+        if (!output_file) {
+            std::cerr << "logger_shm_collector: cannot open " << argv[2] << "\n";
+            return 1;
+        }
+    }
+    std::ostream &out = argc == 3 ? static_cast<std::ostream &>(output_file) : std::cout;
+
+    std::signal(SIGINT, handle_stop);
+    std::signal(SIGTERM, handle_stop);
+
+    std::map<std::string, std::unique_ptr<ShmLogSink::Reader>> readers;
+    std::string payload;
+    int idle_spins = 0;
+
+    while (running.load(std::memory_order_relaxed)) {
+        scan_for_segments(region, readers);
+
+        // Drain in merge order: repeatedly pop the oldest available record
+        // across all segments. Producers keep writing while we do this, so
+        // the ordering is best-effort across the draining window.
+        bool drained_any = false;
+        for (;;) {
+            ShmLogSink::Reader *oldest = nullptr;
+            ShmLogSink::RecordHeader oldest_record{};
+            for (auto &[name, reader] : readers) {
+                ShmLogSink::RecordHeader record{};
+                if (reader->peek(record) &&
+                    (oldest == nullptr || record.timestamp_ns < oldest_record.timestamp_ns)) {
+                    oldest = reader.get();
+                    oldest_record = record;
+                }
+            }
+            if (oldest == nullptr) {
+                break;
+            }
+            payload.clear();
+            oldest->pop(oldest_record, payload);
+            out << "[p" << oldest->producer_pid() << "] " << payload;
+            drained_any = true;
+        }
+
+        // Reap segments whose producer exited and whose ring is empty.
+        for (auto it = readers.begin(); it != readers.end();) {
+            ShmLogSink::RecordHeader record{};
+            if (!it->second->producer_alive() && !it->second->peek(record)) {
+                if (uint64_t dropped = it->second->dropped_count(); dropped > 0) {
+                    std::cerr << "logger_shm_collector: " << it->first << " dropped " << dropped << " records\n";
+                }
+                it->second->unlink();
+                std::cerr << "logger_shm_collector: reaped " << it->first << "\n";
+                it = readers.erase(it);
+            } else {
+                ++it;
+            }
+        }
+
+        if (drained_any) {
+            out.flush();
+            idle_spins = 0;
+        } else if (++idle_spins >= 10) {
+            // nothing arriving; back off so an idle collector costs nothing
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        } else {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+    }
+
+    out.flush();
+    return 0;
+}